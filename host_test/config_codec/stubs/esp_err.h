@@ -0,0 +1,7 @@
+// Host build: the parts of ESP-IDF's esp_err.h that net_manager.h uses.
+#pragma once
+#include <stdint.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
@@ -0,0 +1,13 @@
+// Host build: the parts of ESP-IDF's esp_wifi_types.h that net_manager.h uses.
+#pragma once
+#include <stdint.h>
+
+typedef struct {
+    uint8_t mac[6];
+    int8_t rssi;
+} wifi_sta_info_t;
+
+typedef struct {
+    wifi_sta_info_t sta[15];
+    int num;
+} wifi_sta_list_t;
@@ -0,0 +1,530 @@
+/**
+ * @file test_config_codec.c
+ *
+ * Host tests of the config encoding: round trips, blobs of older and newer firmware, the
+ * frozen v0/v1 layouts, and decoding of corrupted blobs. Pass a number to change the seed.
+ */
+
+#define _GNU_SOURCE // memmem()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "net_manager_config.h"
+
+#define FUZZ_ITERATIONS 20000
+#define CANARY 0xA5
+
+static int s_failures;
+static uint32_t s_rand_state = 1;
+
+#define CHECK(cond)                                                  \
+    do                                                               \
+    {                                                                \
+        if (!(cond))                                                 \
+        {                                                            \
+            fprintf(stderr, "%s:%d: %s\n", __func__, __LINE__, #cond); \
+            s_failures++;                                            \
+        }                                                            \
+    } while (0)
+
+// A config with canary bytes on both sides, to catch writes outside the struct
+typedef struct {
+    uint8_t before[32];
+    net_manager_config_t config;
+    uint8_t after[32];
+} guarded_config_t;
+
+/**
+ * @brief xorshift32, reproducible across hosts.
+ */
+static uint32_t rand32(void)
+{
+    s_rand_state ^= s_rand_state << 13;
+    s_rand_state ^= s_rand_state >> 17;
+    s_rand_state ^= s_rand_state << 5;
+    return s_rand_state;
+}
+
+static void random_str(char *dst, size_t size)
+{
+    size_t len = rand32() % size; // Up to size - 1, the longest string that fits
+    memset(dst, 0, size);
+    for (size_t i = 0; i < len; i++)
+        dst[i] = (char)(1 + rand32() % 255);
+}
+
+static void random_ip_info(esp_netif_ip_info_t *info)
+{
+    info->ip.addr = rand32();
+    info->netmask.addr = rand32();
+    info->gw.addr = rand32();
+}
+
+/**
+ * @brief A config with every field random and the padding zero, so it compares with memcmp.
+ */
+static void random_config(net_manager_config_t *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->wifi_sta_enabled = rand32() & 1;
+    cfg->wifi_ap_enabled = rand32() & 1;
+    cfg->ethernet_enabled = rand32() & 1;
+
+    net_config_wifi_sta_t *sta = &cfg->wifi_sta_config;
+    random_str(sta->ssid, sizeof(sta->ssid));
+    random_str(sta->password, sizeof(sta->password));
+    sta->use_static_ip = rand32() & 1;
+    random_ip_info(&sta->ip_info);
+    sta->dns1.addr = rand32();
+    sta->dns2.addr = rand32();
+
+    net_config_wifi_ap_t *ap = &cfg->wifi_ap_config;
+    random_str(ap->ssid, sizeof(ap->ssid));
+    random_str(ap->password, sizeof(ap->password));
+    ap->on_demand = rand32() & 1;
+    ap->channel = rand32();
+    ap->max_connections = rand32();
+    random_ip_info(&ap->ip_info);
+    ap->dhcp_pool_start.addr = rand32();
+    ap->dhcp_pool_end.addr = rand32();
+    ap->dhcp_lease_time_min = rand32();
+    ap->dns_offer.addr = rand32();
+    ap->auto_off_delay_s = rand32();
+    ap->auto_on_delay_s = rand32();
+    ap->auto_on_failed_retries = rand32();
+
+    net_config_ethernet_t *eth = &cfg->ethernet_config;
+    eth->use_static_ip = rand32() & 1;
+    random_ip_info(&eth->ip_info);
+    eth->dns1.addr = rand32();
+    eth->dns2.addr = rand32();
+    eth->rx_task_priority = rand32();
+    eth->flow_control = rand32() & 1;
+    eth->rx_task_stack_size = rand32();
+    eth->rx_task_pinned = rand32() & 1;
+    eth->rx_task_core = rand32();
+
+    cfg->wifi_buffer_profile = rand32() % (NET_WIFI_BUFFERS_CUSTOM + 1);
+    cfg->wifi_buffers.static_rx_buf_num = rand32();
+    cfg->wifi_buffers.dynamic_rx_buf_num = rand32();
+    cfg->wifi_buffers.static_tx_buf_num = rand32();
+    cfg->wifi_buffers.dynamic_tx_buf_num = rand32();
+    cfg->wifi_buffers.cache_tx_buf_num = rand32();
+    cfg->wifi_buffers.ampdu_rx_win = rand32();
+    cfg->wifi_buffers.ampdu_tx_enable = rand32() & 1;
+    cfg->wifi_buffers.nvs_enable = rand32() & 1;
+}
+
+/**
+ * @brief Copies the records of an encoded section whose tag passes keep().
+ * @return Bytes written to out.
+ */
+static size_t filter_records(const uint8_t *data, size_t len, uint8_t *out, bool (*keep)(uint8_t tag))
+{
+    size_t pos = 0, out_len = 0;
+    while (pos < len)
+    {
+        // All tags and lengths of this layout fit in one varint byte
+        uint8_t tag = data[pos], value_len = data[pos + 1];
+        if (keep(tag))
+        {
+            memcpy(out + out_len, data + pos, 2 + value_len);
+            out_len += 2 + value_len;
+        }
+        pos += 2 + value_len;
+    }
+    return out_len;
+}
+
+static void test_round_trip(void)
+{
+    for (int i = 0; i < 1000; i++)
+    {
+        net_manager_config_t a, b;
+        uint8_t buf[NM_CONFIG_SECTION_BUF_SIZE * NM_CONFIG_SECTION_COUNT];
+        random_config(&a);
+        size_t len = nm_config_encode(&a, buf, sizeof(buf));
+        CHECK(len > 0);
+        memset(&b, 0, sizeof(b));
+        nm_config_decode(buf, len, &b);
+        CHECK(memcmp(&a, &b, sizeof(a)) == 0);
+
+        for (size_t s = 0; s < NM_CONFIG_SECTION_COUNT; s++)
+        {
+            uint8_t section[NM_CONFIG_SECTION_BUF_SIZE];
+            size_t section_len = nm_config_section_encode(s, &a, section, sizeof(section));
+            CHECK(section_len > 0);
+            memset(&b, 0, sizeof(b));
+            nm_config_section_decode(s, section, section_len, &b);
+            CHECK(nm_config_section_encode(s, &b, buf, sizeof(buf)) == section_len);
+            CHECK(memcmp(buf, section, section_len) == 0);
+        }
+    }
+}
+
+static void test_sizes(void)
+{
+    net_manager_config_t cfg;
+    uint8_t buf[NM_CONFIG_SECTION_BUF_SIZE * NM_CONFIG_SECTION_COUNT];
+
+    // Longest strings and largest varints must still fit a section buffer
+    memset(&cfg, 0xFF, sizeof(cfg));
+    memset(cfg.wifi_sta_config.ssid + sizeof(cfg.wifi_sta_config.ssid) - 1, 0, 1);
+    memset(cfg.wifi_sta_config.password + sizeof(cfg.wifi_sta_config.password) - 1, 0, 1);
+    memset(cfg.wifi_ap_config.ssid + sizeof(cfg.wifi_ap_config.ssid) - 1, 0, 1);
+    memset(cfg.wifi_ap_config.password + sizeof(cfg.wifi_ap_config.password) - 1, 0, 1);
+    CHECK(nm_config_encode(&cfg, buf, sizeof(buf)) > 0);
+    net_manager_config_t out;
+    memset(&out, 0, sizeof(out));
+    nm_config_decode(buf, nm_config_encode(&cfg, buf, sizeof(buf)), &out);
+    CHECK(out.wifi_ap_config.dhcp_lease_time_min == UINT32_MAX);
+    CHECK(out.wifi_buffers.dynamic_rx_buf_num == UINT16_MAX);
+
+    // A typical config is smaller than the struct, and a short buffer fails cleanly
+    memset(&cfg, 0, sizeof(cfg));
+    strcpy(cfg.wifi_sta_config.ssid, "home");
+    strcpy(cfg.wifi_sta_config.password, "secret123");
+    cfg.wifi_sta_enabled = true;
+    size_t len = nm_config_encode(&cfg, buf, sizeof(buf));
+    CHECK(len > 0 && len < sizeof(cfg));
+    CHECK(nm_config_encode(&cfg, buf, len - 1) == 0);
+    CHECK(nm_config_section_encode(NM_CONFIG_SECTION_COUNT, &cfg, buf, sizeof(buf)) == 0);
+}
+
+/**
+ * @brief Catches renumbered tags and changed kinds: stored blobs depend on them.
+ */
+static void test_golden_encoding(void)
+{
+    net_manager_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    strcpy(cfg.wifi_sta_config.ssid, "ab");
+    cfg.wifi_sta_config.use_static_ip = true;
+    cfg.wifi_sta_config.ip_info.ip.addr = 0x04030201;
+    cfg.wifi_sta_config.dns2.addr = 0x08080808;
+    const uint8_t expected[] = {
+        1, 2, 'a', 'b',                               // ssid
+        2, 0,                                         // password
+        3, 1, 1,                                      // use_static_ip
+        4, 12, 1, 2, 3, 4, 0, 0, 0, 0, 0, 0, 0, 0,    // ip_info
+        5, 4, 0, 0, 0, 0,                             // dns1
+        6, 4, 8, 8, 8, 8,                             // dns2
+    };
+    uint8_t buf[NM_CONFIG_SECTION_BUF_SIZE];
+    CHECK(nm_config_section_encode(NM_CONFIG_SECTION_STA, &cfg, buf, sizeof(buf)) == sizeof(expected));
+    CHECK(memcmp(buf, expected, sizeof(expected)) == 0);
+
+    cfg.wifi_ap_config.dhcp_lease_time_min = 300;
+    size_t len = nm_config_section_encode(NM_CONFIG_SECTION_AP, &cfg, buf, sizeof(buf));
+    const uint8_t lease[] = {9, 2, 0xAC, 0x02}; // Tag 9, varint 300
+    CHECK(len > 0 && memmem(buf, len, lease, sizeof(lease)) != NULL);
+
+    CHECK(strcmp(nm_config_section_key(NM_CONFIG_SECTION_ENABLE), "cfg_en") == 0);
+    CHECK(strcmp(nm_config_section_key(NM_CONFIG_SECTION_STA), "cfg_sta") == 0);
+    CHECK(strcmp(nm_config_section_key(NM_CONFIG_SECTION_AP), "cfg_ap") == 0);
+    CHECK(strcmp(nm_config_section_key(NM_CONFIG_SECTION_ETH), "cfg_eth") == 0);
+    CHECK(nm_config_section_key(NM_CONFIG_SECTION_COUNT) == NULL);
+}
+
+static bool keep_first_version_eth_tags(uint8_t tag)
+{
+    return tag <= 4; // ETH tags of NVS config version 2 as first released
+}
+
+static bool keep_first_version_enable_tags(uint8_t tag)
+{
+    return tag <= 3;
+}
+
+/**
+ * @brief Blobs of older firmware lack tags: the defaults stay for those fields.
+ */
+static void test_older_firmware(void)
+{
+    net_manager_config_t cfg, out, defaults;
+    random_config(&cfg);
+    random_config(&defaults);
+
+    uint8_t full[NM_CONFIG_SECTION_BUF_SIZE], old[NM_CONFIG_SECTION_BUF_SIZE];
+    size_t len = nm_config_section_encode(NM_CONFIG_SECTION_ETH, &cfg, full, sizeof(full));
+    size_t old_len = filter_records(full, len, old, keep_first_version_eth_tags);
+    out = defaults;
+    nm_config_section_decode(NM_CONFIG_SECTION_ETH, old, old_len, &out);
+    CHECK(memcmp(&out.ethernet_config.ip_info, &cfg.ethernet_config.ip_info, sizeof(esp_netif_ip_info_t)) == 0);
+    CHECK(out.ethernet_config.dns2.addr == cfg.ethernet_config.dns2.addr);
+    CHECK(out.ethernet_config.rx_task_priority == defaults.ethernet_config.rx_task_priority);
+    CHECK(out.ethernet_config.flow_control == defaults.ethernet_config.flow_control);
+
+    len = nm_config_section_encode(NM_CONFIG_SECTION_ENABLE, &cfg, full, sizeof(full));
+    old_len = filter_records(full, len, old, keep_first_version_enable_tags);
+    out = defaults;
+    nm_config_section_decode(NM_CONFIG_SECTION_ENABLE, old, old_len, &out);
+    CHECK(out.ethernet_enabled == cfg.ethernet_enabled);
+    CHECK(out.wifi_buffer_profile == defaults.wifi_buffer_profile);
+    CHECK(memcmp(&out.wifi_buffers, &defaults.wifi_buffers, sizeof(out.wifi_buffers)) == 0);
+
+    // Missing sections keep their defaults too
+    uint8_t buf[NM_CONFIG_SECTION_BUF_SIZE * NM_CONFIG_SECTION_COUNT];
+    len = nm_config_encode(&cfg, buf, sizeof(buf));
+    size_t first_len = 2 + buf[1]; // Section 0 (enable flags), its length fits one byte
+    out = defaults;
+    nm_config_decode(buf, first_len, &out);
+    CHECK(out.wifi_sta_enabled == cfg.wifi_sta_enabled);
+    CHECK(memcmp(&out.wifi_sta_config, &defaults.wifi_sta_config, sizeof(out.wifi_sta_config)) == 0);
+}
+
+/**
+ * @brief Blobs of newer firmware carry unknown tags and sections: they are skipped.
+ */
+static void test_newer_firmware(void)
+{
+    net_manager_config_t cfg, out;
+    random_config(&cfg);
+
+    uint8_t section[NM_CONFIG_SECTION_BUF_SIZE + 16];
+    size_t len = nm_config_section_encode(NM_CONFIG_SECTION_AP, &cfg, section + 6, NM_CONFIG_SECTION_BUF_SIZE);
+    const uint8_t unknown_head[] = {99, 4, 1, 2, 3, 4};      // Unknown tag in front
+    const uint8_t unknown_tail[] = {0x80, 0x01, 2, 0xFF, 0x7F}; // Two-byte tag 128 at the end
+    memcpy(section, unknown_head, sizeof(unknown_head));
+    memcpy(section + 6 + len, unknown_tail, sizeof(unknown_tail));
+    memset(&out, 0, sizeof(out));
+    nm_config_section_decode(NM_CONFIG_SECTION_AP, section, 6 + len + sizeof(unknown_tail), &out);
+    CHECK(memcmp(&out.wifi_ap_config, &cfg.wifi_ap_config, sizeof(cfg.wifi_ap_config)) == 0);
+
+    // Unknown section 7 between known ones
+    uint8_t buf[NM_CONFIG_SECTION_BUF_SIZE * (NM_CONFIG_SECTION_COUNT + 1)];
+    size_t pos = 0;
+    buf[pos++] = 7;
+    buf[pos++] = 3;
+    buf[pos++] = 1;
+    buf[pos++] = 1;
+    buf[pos++] = 1;
+    pos += nm_config_encode(&cfg, buf + pos, sizeof(buf) - pos);
+    memset(&out, 0, sizeof(out));
+    nm_config_decode(buf, pos, &out);
+    CHECK(memcmp(&out, &cfg, sizeof(cfg)) == 0);
+}
+
+/**
+ * @brief Records whose value no longer fits their field are skipped, strings are cut.
+ */
+static void test_mismatched_values(void)
+{
+    net_manager_config_t out;
+    memset(&out, 0, sizeof(out));
+    out.wifi_sta_config.dns1.addr = 0x01020304;
+
+    uint8_t section[128];
+    size_t pos = 0;
+    section[pos++] = 5; // dns1 with 6 bytes: skipped
+    section[pos++] = 6;
+    memset(section + pos, 0xEE, 6);
+    pos += 6;
+    section[pos++] = 3; // use_static_ip with a 6-byte varint: skipped
+    section[pos++] = 6;
+    memset(section + pos, 0x81, 5);
+    section[pos + 5] = 0x01;
+    pos += 6;
+    section[pos++] = 1; // ssid of 40 bytes: cut to 31 and terminated
+    section[pos++] = 40;
+    memset(section + pos, 'x', 40);
+    pos += 40;
+    nm_config_section_decode(NM_CONFIG_SECTION_STA, section, pos, &out);
+    CHECK(out.wifi_sta_config.dns1.addr == 0x01020304);
+    CHECK(out.wifi_sta_config.use_static_ip == false);
+    CHECK(strlen(out.wifi_sta_config.ssid) == sizeof(out.wifi_sta_config.ssid) - 1);
+}
+
+/**
+ * @brief Baseline firmware stored the whole struct under "net_config".
+ */
+static void test_legacy_v0(void)
+{
+    legacy_config_v0_t v0;
+    memset(&v0, 0, sizeof(v0));
+    v0.wifi_sta_enabled = true;
+    v0.ethernet_enabled = true;
+    strcpy(v0.wifi_sta_config.ssid, "legacy-sta");
+    memset(v0.wifi_sta_config.password, 'p', sizeof(v0.wifi_sta_config.password)); // No terminator
+    v0.wifi_sta_config.use_static_ip = true;
+    v0.wifi_sta_config.ip_info.gw.addr = 0x0101A8C0;
+    v0.wifi_sta_config.dns2.addr = 0x08080808;
+    strcpy(v0.wifi_ap_config.ssid, "legacy-ap");
+    v0.wifi_ap_config.channel = 11;
+    v0.wifi_ap_config.max_connections = 3;
+    v0.ethernet_config.use_static_ip = true;
+    v0.ethernet_config.dns1.addr = 0x01010101;
+
+    net_manager_config_t defaults, out;
+    random_config(&defaults);
+    out = defaults;
+    CHECK(nm_config_decode_v0(&v0, sizeof(v0), &out));
+    CHECK(out.wifi_sta_enabled && !out.wifi_ap_enabled && out.ethernet_enabled);
+    CHECK(strcmp(out.wifi_sta_config.ssid, "legacy-sta") == 0);
+    CHECK(strlen(out.wifi_sta_config.password) == sizeof(out.wifi_sta_config.password) - 1);
+    CHECK(out.wifi_sta_config.use_static_ip);
+    CHECK(out.wifi_sta_config.ip_info.gw.addr == 0x0101A8C0);
+    CHECK(out.wifi_sta_config.dns2.addr == 0x08080808);
+    CHECK(strcmp(out.wifi_ap_config.ssid, "legacy-ap") == 0);
+    CHECK(out.wifi_ap_config.channel == 11);
+    CHECK(out.wifi_ap_config.max_connections == 3);
+    CHECK(out.ethernet_config.use_static_ip);
+    CHECK(out.ethernet_config.dns1.addr == 0x01010101);
+    // Fields the baseline did not have keep their defaults
+    CHECK(out.wifi_ap_config.on_demand == defaults.wifi_ap_config.on_demand);
+    CHECK(out.wifi_ap_config.dhcp_lease_time_min == defaults.wifi_ap_config.dhcp_lease_time_min);
+    CHECK(out.ethernet_config.rx_task_priority == defaults.ethernet_config.rx_task_priority);
+    CHECK(out.wifi_buffer_profile == defaults.wifi_buffer_profile);
+
+    // The baseline layout is 248 bytes on the 32-bit targets, and so here
+    CHECK(sizeof(legacy_config_v0_t) == 248);
+    uint8_t blob[sizeof(v0) + 1] = {0};
+    memcpy(blob + 1, &v0, sizeof(v0)); // Unaligned source
+    out = defaults;
+    CHECK(nm_config_decode_v0(blob + 1, sizeof(v0), &out));
+    CHECK(strcmp(out.wifi_ap_config.ssid, "legacy-ap") == 0);
+
+    out = defaults;
+    CHECK(!nm_config_decode_v0(&v0, sizeof(v0) - 1, &out));
+    CHECK(!nm_config_decode_v0(blob, sizeof(blob), &out));
+    CHECK(memcmp(&out, &defaults, sizeof(out)) == 0);
+}
+
+/**
+ * @brief NVS config version 1 stored each section as a raw struct.
+ */
+static void test_legacy_v1(void)
+{
+    net_manager_config_t defaults, out;
+    random_config(&defaults);
+
+    legacy_enable_v1_t en = {.wifi_sta_enabled = true, .wifi_ap_enabled = true, .ethernet_enabled = false};
+    out = defaults;
+    CHECK(nm_config_decode_v1_section(NM_CONFIG_SECTION_ENABLE, &en, sizeof(en), &out));
+    CHECK(out.wifi_sta_enabled && out.wifi_ap_enabled && !out.ethernet_enabled);
+    CHECK(out.wifi_buffer_profile == defaults.wifi_buffer_profile);
+
+    legacy_ap_v1_t ap;
+    memset(&ap, 0, sizeof(ap));
+    strcpy(ap.ssid, "v1-ap");
+    ap.on_demand = true;
+    ap.channel = 6;
+    ap.max_connections = 4;
+    ap.dhcp_pool_end.addr = 0x6404A8C0;
+    ap.dhcp_lease_time_min = 1440;
+    ap.auto_on_delay_s = 30;
+    ap.auto_on_failed_retries = 5;
+    out = defaults;
+    CHECK(nm_config_decode_v1_section(NM_CONFIG_SECTION_AP, &ap, sizeof(ap), &out));
+    CHECK(strcmp(out.wifi_ap_config.ssid, "v1-ap") == 0);
+    CHECK(out.wifi_ap_config.on_demand && out.wifi_ap_config.channel == 6 && out.wifi_ap_config.max_connections == 4);
+    CHECK(out.wifi_ap_config.dhcp_pool_end.addr == 0x6404A8C0);
+    CHECK(out.wifi_ap_config.dhcp_lease_time_min == 1440);
+    CHECK(out.wifi_ap_config.auto_on_delay_s == 30 && out.wifi_ap_config.auto_on_failed_retries == 5);
+
+    legacy_eth_v0_t eth = {.use_static_ip = true, .dns2 = {.addr = 0x04040808}};
+    out = defaults;
+    CHECK(nm_config_decode_v1_section(NM_CONFIG_SECTION_ETH, &eth, sizeof(eth), &out));
+    CHECK(out.ethernet_config.use_static_ip && out.ethernet_config.dns2.addr == 0x04040808);
+    CHECK(out.ethernet_config.rx_task_priority == defaults.ethernet_config.rx_task_priority);
+
+    legacy_sta_v0_t sta;
+    memset(&sta, 0, sizeof(sta));
+    strcpy(sta.ssid, "v1-sta");
+    out = defaults;
+    CHECK(nm_config_decode_v1_section(NM_CONFIG_SECTION_STA, &sta, sizeof(sta), &out));
+    CHECK(strcmp(out.wifi_sta_config.ssid, "v1-sta") == 0);
+
+    // Sizes of any other layout are refused without touching the config
+    out = defaults;
+    CHECK(!nm_config_decode_v1_section(NM_CONFIG_SECTION_ENABLE, &en, sizeof(en) + 1, &out));
+    CHECK(!nm_config_decode_v1_section(NM_CONFIG_SECTION_AP, &ap, sizeof(ap) - 1, &out));
+    CHECK(!nm_config_decode_v1_section(NM_CONFIG_SECTION_ETH, &out.ethernet_config, sizeof(out.ethernet_config), &out));
+    CHECK(!nm_config_decode_v1_section(NM_CONFIG_SECTION_COUNT, &eth, sizeof(eth), &out));
+    CHECK(memcmp(&out, &defaults, sizeof(out)) == 0);
+}
+
+/**
+ * @brief Mutated and truncated blobs must decode without touching memory outside the
+ *        config and leave every string terminated.
+ */
+static void test_fuzz(void)
+{
+    for (int i = 0; i < FUZZ_ITERATIONS; i++)
+    {
+        net_manager_config_t cfg;
+        uint8_t buf[NM_CONFIG_SECTION_BUF_SIZE * NM_CONFIG_SECTION_COUNT];
+        random_config(&cfg);
+        size_t len = nm_config_encode(&cfg, buf, sizeof(buf));
+
+        switch (rand32() % 4)
+        {
+        case 0: // Bit flips
+            for (int n = 1 + rand32() % 8; n > 0; n--)
+                buf[rand32() % len] ^= 1 << (rand32() % 8);
+            break;
+        case 1: // Truncation
+            len = rand32() % len;
+            break;
+        case 2: // Random bytes over a run
+        {
+            size_t start = rand32() % len;
+            size_t run = 1 + rand32() % (len - start);
+            for (size_t n = 0; n < run; n++)
+                buf[start + n] = rand32();
+            break;
+        }
+        default: // Pure noise
+            len = rand32() % sizeof(buf);
+            for (size_t n = 0; n < len; n++)
+                buf[n] = rand32();
+            break;
+        }
+
+        // Exact-size copy, so ASan reports any read past the blob
+        uint8_t *blob = malloc(len ? len : 1);
+        memcpy(blob, buf, len);
+        guarded_config_t out;
+        memset(&out, CANARY, sizeof(out));
+        if (rand32() & 1)
+            nm_config_decode(blob, len, &out.config);
+        else
+            nm_config_section_decode(rand32() % (NM_CONFIG_SECTION_COUNT + 1), blob, len, &out.config);
+        free(blob);
+
+        for (size_t n = 0; n < sizeof(out.before); n++)
+            CHECK(out.before[n] == CANARY && out.after[n] == CANARY);
+        // Strings are either untouched (canary bytes) or terminated by the decoder
+        const net_manager_config_t *c = &out.config;
+        CHECK(c->wifi_sta_config.ssid[sizeof(c->wifi_sta_config.ssid) - 1] == 0 ||
+              (uint8_t)c->wifi_sta_config.ssid[0] == CANARY);
+        CHECK(c->wifi_ap_config.password[sizeof(c->wifi_ap_config.password) - 1] == 0 ||
+              (uint8_t)c->wifi_ap_config.password[0] == CANARY);
+        if (s_failures)
+        {
+            fprintf(stderr, "Fuzz iteration %d failed\n", i);
+            return;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    s_rand_state = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 0x4E4D4346;
+    if (s_rand_state == 0)
+        s_rand_state = 1;
+    printf("Seed 0x%08X\n", (unsigned)s_rand_state);
+
+    test_round_trip();
+    test_sizes();
+    test_golden_encoding();
+    test_older_firmware();
+    test_newer_firmware();
+    test_mismatched_values();
+    test_legacy_v0();
+    test_legacy_v1();
+    test_fuzz();
+
+    printf("Config codec: %s (%d failed checks)\n", s_failures ? "FAIL" : "PASS", s_failures);
+    return s_failures ? 1 : 0;
+}
@@ -24,6 +24,11 @@ typedef enum {
     NET_STATUS_WAITING_FOR_RECONNECT,
     NET_STATUS_CLIENT_CONNECTED,    // AP Mode: a client connected
     NET_STATUS_CLIENT_DISCONNECTED, // AP Mode: a client disconnected
+    NET_STATUS_BOUND_INTERFACE_LOST, // A socket bound via net_manager_bind_socket() lost its interface
+    NET_STATUS_GOT_IP6,              // An IPv6 address was assigned (data: esp_netif_ip6_info_t)
+    NET_STATUS_IP_LOST,              // STA/ETH: the IPv4 lease was lost and no routable IPv6 address is left, link may still be up
+    NET_STATUS_ADDRESS_CHANGED,      // STA/ETH: the IPv4 address changed, or came after IPv6 made the interface CONNECTED (data: esp_netif_ip_info_t), rebuild sockets
+    NET_STATUS_CONFIG_ROLLBACK,      // CONFIG: a config on trial never connected or failed to start, the last-known-good one was restored (data: esp_err_t of the restart)
 } net_status_t;
 
 /**
@@ -46,8 +51,22 @@ typedef struct {
 typedef struct {
     char ssid[32];
     char password[64];
-    uint8_t channel;
+    uint8_t channel;         // 0 = pick the least congested channel at start (an AP-only radio scans in APSTA mode, off channel for a moment)
     uint8_t max_connections;
+
+    // --- Subnet and DHCP Server (zero fields keep the ESP-IDF defaults, 192.168.4.1/24) ---
+    esp_netif_ip_info_t ip_info;      // AP address, netmask, gateway offered to clients
+    esp_ip4_addr_t dhcp_pool_start;   // First address of the DHCP pool
+    esp_ip4_addr_t dhcp_pool_end;     // Last address of the DHCP pool
+    uint32_t dhcp_lease_time_min;     // Lease time in minutes
+    esp_ip4_addr_t dns_offer;         // DNS server offered to clients, 0 = don't offer
+
+    // --- Provisioning AP Policy (APSTA only, zero disables) ---
+    uint16_t auto_off_delay_s;        // Stop the AP this long after the STA is connected and no client is on the AP
+    uint16_t auto_on_delay_s;         // Bring the AP back after the STA has been disconnected this long
+    uint8_t auto_on_failed_retries;   // ...or as soon as the STA failed this many reconnects
+
+    bool on_demand;                   // Declare only; allocate with net_manager_ap_enable()
 } net_config_wifi_ap_t;
 
 /**
@@ -60,8 +79,44 @@ typedef struct {
     esp_netif_ip_info_t ip_info; // Holds IP, netmask, gateway
     esp_ip4_addr_t dns1;         // Primary DNS server
     esp_ip4_addr_t dns2;         // Secondary DNS server
+
+    // --- Driver Tuning (DMA buffer counts are CONFIG_ETH_DMA_RX/TX_BUFFER_NUM) ---
+    // RX task settings the driver can't take fail net_manager_start() with ESP_ERR_NOT_SUPPORTED.
+    uint8_t rx_task_priority;    // MAC RX task priority, 0 = ethernet_init default
+    bool flow_control;           // IEEE 802.3x pause frames (full duplex links)
+    uint16_t rx_task_stack_size; // Must be 0 (ethernet_init default), the stack is sized when the driver is created
+    bool rx_task_pinned;         // Pin the MAC RX task to rx_task_core (CONFIG_FREERTOS_SMP only)
+    uint8_t rx_task_core;
 } net_config_ethernet_t;
 
+/**
+ * @brief Wi-Fi driver buffer profile, applied to wifi_init_config_t when Wi-Fi is initialized.
+ *        The named profiles also turn off the driver's own NVS copy of the Wi-Fi config,
+ *        net_manager applies its config on every start.
+ */
+typedef enum {
+    NET_WIFI_BUFFERS_DEFAULT,         // WIFI_INIT_CONFIG_DEFAULT(), i.e. the sdkconfig Wi-Fi settings
+    NET_WIFI_BUFFERS_LOW_MEMORY,      // Few RX/TX buffers, no AMPDU: smallest heap, lowest throughput
+    NET_WIFI_BUFFERS_BALANCED,        // ESP-IDF default buffer counts
+    NET_WIFI_BUFFERS_HIGH_THROUGHPUT, // iperf example buffer counts and 32-frame block-ack window
+    NET_WIFI_BUFFERS_CUSTOM,          // The counts in net_manager_config_t.wifi_buffers
+} net_wifi_buffer_profile_t;
+
+/**
+ * @brief Wi-Fi driver buffer settings for NET_WIFI_BUFFERS_CUSTOM
+ *        (see wifi_init_config_t for the valid ranges)
+ */
+typedef struct {
+    uint8_t static_rx_buf_num;
+    uint16_t dynamic_rx_buf_num; // 0 = unlimited
+    uint8_t static_tx_buf_num;   // 0 = dynamic TX buffers
+    uint8_t dynamic_tx_buf_num;
+    uint8_t cache_tx_buf_num;    // SPIRAM only, 0 otherwise
+    uint8_t ampdu_rx_win;        // Block-ack window of AMPDU RX, 0 = AMPDU RX off
+    bool ampdu_tx_enable;
+    bool nvs_enable;             // Let the driver keep its own copy of the Wi-Fi config in NVS
+} net_wifi_buffers_t;
+
 /**
  * @brief Master configuration structure for the network manager
  */
@@ -73,8 +128,63 @@ typedef struct {
     net_config_wifi_sta_t wifi_sta_config;
     net_config_wifi_ap_t  wifi_ap_config;
     net_config_ethernet_t ethernet_config;
+
+    net_wifi_buffer_profile_t wifi_buffer_profile; // Takes effect when Wi-Fi is (re)initialized
+    net_wifi_buffers_t wifi_buffers;               // Only used with NET_WIFI_BUFFERS_CUSTOM
 } net_manager_config_t;
 
+#define NET_MANAGER_PROFILE_NAME_MAX 12 // Profile names are NVS key suffixes
+
+/**
+ * @brief NVS write counters, see net_manager_get_config_save_stats()
+ */
+typedef struct {
+    uint32_t saves;                 // NVS commits (deferred saves coalesce into one)
+    uint32_t last_bytes_written;    // Payload bytes written by the last commit, 0 if nothing changed
+    uint8_t last_sections_written;  // Config sections (enable flags, STA, AP, ETH) rewritten by the last commit
+    uint8_t last_sections_skipped;  // Sections left untouched because they were unchanged
+    uint32_t total_bytes_written;   // Since init
+} net_config_save_stats_t;
+
+/**
+ * @brief Bring-up phases measured by the memory report
+ */
+typedef enum {
+    NET_MEM_PHASE_WIFI_INIT,  // esp_wifi_init(): driver structures and static buffers
+    NET_MEM_PHASE_WIFI_START, // esp_wifi_start(): driver task and dynamic buffers
+    NET_MEM_PHASE_STA,        // STA netif and configuration
+    NET_MEM_PHASE_AP,         // AP netif, DHCP server and configuration
+    NET_MEM_PHASE_ETH,        // Ethernet driver, netif and glue, including esp_eth_start()
+    NET_MEM_PHASE_MAX,
+} net_mem_phase_t;
+
+/**
+ * @brief Heap consumed by one bring-up phase, measured the last time it ran.
+ *        Negative values mean the phase released memory.
+ */
+typedef struct {
+    int32_t internal_bytes;         // Drop in free internal RAM
+    int32_t internal_largest_block; // Drop in the largest free internal block (fragmentation)
+    int32_t spiram_bytes;           // Drop in free SPIRAM, 0 without SPIRAM
+    int32_t spiram_largest_block;
+    uint32_t runs;                  // Times the phase ran since init
+} net_mem_phase_cost_t;
+
+/**
+ * @brief Memory footprint report, see net_manager_get_memory_report()
+ */
+typedef struct {
+    net_mem_phase_cost_t phases[NET_MEM_PHASE_MAX];
+    size_t internal_free;           // Heap state when the report was taken
+    size_t internal_min_free;       // Low-water mark since boot
+    size_t internal_largest_block;
+    size_t spiram_free;
+    size_t spiram_largest_block;
+    size_t static_bytes;            // RAM of the component's own tables and buffers (.bss)
+    uint32_t worker_stack_free_min; // Worker task stack high-water mark, bytes never used
+    uint8_t work_queue_peak;        // Most work items ever queued at once
+} net_memory_report_t;
+
 /**
  * @brief Source of a network event
  */
@@ -82,19 +192,141 @@ typedef enum {
     NET_EVENT_SOURCE_STA,
     NET_EVENT_SOURCE_AP,
     NET_EVENT_SOURCE_ETHERNET,
+    NET_EVENT_SOURCE_CONFIG, // Config lifecycle events, not an interface
 } net_event_source_t;
 
+/**
+ * @brief Interface selection policy for net_manager_bind_socket()
+ */
+typedef enum {
+    NET_BIND_POLICY_PRIMARY,         // The interface currently holding the default route
+    NET_BIND_POLICY_LOWEST_RTT,      // The connected interface with the lowest measured RTT
+    NET_BIND_POLICY_SPECIFIC_SOURCE, // The interface given in net_bind_policy_t.source
+} net_bind_policy_type_t;
+
+/**
+ * @brief Socket binding policy
+ */
+typedef struct {
+    net_bind_policy_type_t type;
+    net_event_source_t source; // Only used with NET_BIND_POLICY_SPECIFIC_SOURCE
+} net_bind_policy_t;
+
+/**
+ * @brief Wi-Fi STA power-save policy, see net_manager_set_power_save()
+ */
+typedef enum {
+    NET_POWER_SAVE_MAX_PERF,  // WIFI_PS_NONE: radio always on, lowest latency
+    NET_POWER_SAVE_BALANCED,  // WIFI_PS_MIN_MODEM: wake for every DTIM beacon (driver default)
+    NET_POWER_SAVE_LOW_POWER, // WIFI_PS_MAX_MODEM: wake every CONFIG_NET_MANAGER_PS_LISTEN_INTERVAL beacons
+    NET_POWER_SAVE_AUTO,      // MAX_PERF while there is traffic, LOW_POWER after CONFIG_NET_MANAGER_PS_AUTO_IDLE_S without
+} net_power_save_t;
+
+/**
+ * @brief Per-server DNS statistics, see net_manager_get_dns_stats()
+ */
+typedef struct {
+    esp_ip4_addr_t addr;     // Server address, 0 if the slot is unused
+    uint32_t avg_latency_ms; // Smoothed latency of successful lookups
+    uint32_t lookups;        // Lookups sent to this server
+    uint32_t failures;       // Lookups this server did not answer
+} net_dns_server_stats_t;
+
+/**
+ * @brief A client associated with the soft-AP, see net_manager_get_ap_clients()
+ */
+typedef struct {
+    uint8_t mac[6];
+    uint16_t aid;
+    int8_t rssi;           // Last known RSSI (join time, or last probe request with AP idle eviction)
+    esp_ip4_addr_t ip;     // Address handed out by the DHCP server, 0 until assigned
+    int64_t join_time_us;  // esp_timer time of association
+    int64_t last_active_us; // esp_timer time of the last frame (or probe request, with AP idle eviction) received from the client
+    uint32_t join_to_ip_ms; // Association to DHCP address assignment, 0 until assigned
+    uint64_t rx_bytes;     // Bytes received from the client (Ethernet frames, since it joined)
+    uint64_t tx_bytes;     // Unicast bytes sent to the client
+} net_ap_client_t;
+
+/**
+ * @brief Soft-AP admission control counters, see net_manager_get_ap_admission_stats()
+ */
+typedef struct {
+    uint32_t admitted;      // Associations accepted
+    uint32_t rate_limited;  // Associations refused because the join token bucket was empty
+    uint32_t evicted_idle;  // Clients deauthenticated to make room for a new one
+} net_ap_admission_stats_t;
+
+/**
+ * @brief Soft-AP client loss caused by the AP following the STA to another channel
+ *        (APSTA mode), see net_manager_get_ap_roam_stats()
+ */
+typedef struct {
+    uint32_t channel_moves;     // STA (re)connects that moved the AP to another channel
+    uint32_t clients_lost;      // Clients that dropped within the window after a move
+    uint32_t clients_rejoined;  // Lost clients that associated again
+    uint32_t avg_rejoin_ms;     // Mean channel move to re-association time of rejoined clients
+    uint32_t max_rejoin_ms;
+    uint8_t last_move_clients;  // Clients connected when the last move happened
+    uint8_t last_move_lost;     // Of which dropped
+    int64_t last_move_time_us;  // esp_timer time of the last move
+} net_ap_roam_stats_t;
+
+/**
+ * @brief A DHCP lease handed out by the soft-AP, see net_manager_get_ap_leases()
+ */
+typedef struct {
+    uint8_t mac[6];
+    esp_ip4_addr_t ip;
+    int64_t assigned_time_us; // esp_timer time of the (last) assignment
+    int64_t expires_time_us;  // esp_timer time the lease runs out
+    uint32_t join_to_ip_ms;   // Association to address assignment latency
+} net_ap_lease_t;
+
 /**
  * @brief Event structure passed to the user callback
  */
 typedef struct {
     net_event_source_t source;
     net_status_t status;
-    void* data; // Context-specific data (e.g., esp_netif_ip_info_t on connect)
+    void* data; // Context-specific data (e.g., esp_netif_ip_info_t on connect, int fd on BOUND_INTERFACE_LOST); copy what is needed, it is only valid during the callback
 } net_manager_event_t;
 
+#define NET_MANAGER_IP6_ADDR_MAX 5 // Upper bound of CONFIG_LWIP_IPV6_NUM_ADDRESSES
+
+/**
+ * @brief IPv6 address with its scope
+ */
+typedef struct {
+    esp_ip6_addr_t addr;
+    esp_ip6_addr_type_t type; // ESP_IP6_ADDR_IS_LINK_LOCAL, _GLOBAL, _UNIQUE_LOCAL, ...
+} net_ip6_addr_t;
+
+/**
+ * @brief IPv6 addresses currently assigned to an interface
+ */
+typedef struct {
+    uint8_t count;
+    net_ip6_addr_t addrs[NET_MANAGER_IP6_ADDR_MAX];
+} net_ip6_info_t;
+
+/**
+ * @brief Traffic counters of one interface since it started, taken at the link layer.
+ *        All zero if CONFIG_NET_MANAGER_TRAFFIC_HOOKS_ENABLED is not set.
+ */
+typedef struct {
+    uint64_t rx_bytes;
+    uint64_t tx_bytes;
+    uint32_t rx_packets;
+    uint32_t tx_packets;
+    uint32_t rx_dropped; // Received frames the TCP/IP stack refused (input queue full)
+    uint32_t tx_dropped; // Frames the driver failed to send (e.g. TX buffers exhausted)
+} net_traffic_stats_t;
+
 /**
  * @brief Network manager status structure
+ * @note An interface is NET_STATUS_CONNECTED once it has an IPv4 address or a routable
+ *       (global or unique local) IPv6 address, whichever comes first. CONNECTED is
+ *       dispatched once per connection.
  */
 typedef struct {
     net_status_t sta_status;
@@ -105,7 +337,18 @@ typedef struct {
     esp_netif_ip_info_t ap_ip_info;
     esp_netif_ip_info_t eth_ip_info;
 
+    net_ip6_info_t sta_ip6_info;
+    net_ip6_info_t eth_ip6_info;
+
     uint8_t ap_connected_clients;
+    bool ap_suspended; // AP stopped by the provisioning AP policy, see net_config_wifi_ap_t
+
+    uint32_t sta_rx_dropped; // Received frames the TCP/IP stack refused (input queue full) since the interface started
+    uint32_t eth_rx_dropped; // Same as sta_traffic.rx_dropped / eth_traffic.rx_dropped
+
+    net_traffic_stats_t sta_traffic;
+    net_traffic_stats_t ap_traffic;
+    net_traffic_stats_t eth_traffic;
 } net_manager_status_t;
 
 
@@ -138,10 +381,57 @@ esp_err_t net_manager_deinit(void);
  *
  * @param config Pointer to the network configuration. If NULL, default configuration
  *               from Kconfig or NVS will be used.
- * @return esp_err_t ESP_OK on success.
+ * @return esp_err_t ESP_OK on success, or the error of the interface that failed to start.
  */
 esp_err_t net_manager_start(const net_manager_config_t *config);
 
+/**
+ * @brief Applies a new configuration on trial, with automatic rollback.
+ *        The config is written to the spare NVS slot and started. It becomes the
+ *        last-known-good config once the STA or Ethernet reaches NET_STATUS_CONNECTED.
+ *        If neither does within CONFIG_NET_MANAGER_CONFIG_TRIAL_TIMEOUT_S, the previous
+ *        config is restarted (no reboot) and NET_STATUS_CONFIG_ROLLBACK is dispatched.
+ *        A config that fails to start is rolled back at once. A config saved with
+ *        net_manager_save_config_to_nvs() during the trial survives the confirmation.
+ *        A trial interrupted by a restart resumes on net_manager_start(NULL).
+ *
+ * @param config Pointer to the configuration to try.
+ * @return esp_err_t ESP_OK if the trial started, ESP_ERR_INVALID_STATE if one is already running,
+ *         or the start error of a config that was rolled back.
+ */
+esp_err_t net_manager_apply_config(const net_manager_config_t *config);
+
+/**
+ * @brief Stores a named configuration profile in NVS (at most
+ *        CONFIG_NET_MANAGER_MAX_PROFILES). An existing profile of that name is replaced.
+ *
+ * @param name Profile name, 1 to NET_MANAGER_PROFILE_NAME_MAX characters.
+ * @param config Configuration to store.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if all profile slots are in use,
+ *         or an NVS error if the profile index can't be read.
+ */
+esp_err_t net_manager_save_profile(const char *name, const net_manager_config_t *config);
+
+/**
+ * @brief Deletes a named configuration profile.
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if there is no such profile,
+ *         or an NVS error if the profile index can't be read.
+ */
+esp_err_t net_manager_delete_profile(const char *name);
+
+/**
+ * @brief Switches to a named profile without a reboot. Only interfaces whose settings
+ *        differ are restarted (Ethernet and Wi-Fi independently; the AP alone if the STA
+ *        settings are the same). Once it started, the profile also becomes the saved
+ *        configuration; if it fails to start, the saved configuration is left unchanged.
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if there is no such profile,
+ *         ESP_ERR_INVALID_STATE while a net_manager_apply_config() trial runs, or the
+ *         error of the interface restart (interfaces may then be partly up).
+ */
+esp_err_t net_manager_activate_profile(const char *name);
+
 /**
  * @brief Stops all active network interfaces.
  *
@@ -149,6 +439,45 @@ esp_err_t net_manager_start(const net_manager_config_t *config);
  */
 esp_err_t net_manager_stop(void);
 
+/**
+ * @brief Brings up an AP declared with on_demand in the active configuration: creates the
+ *        AP netif and DHCP server and switches Wi-Fi from STA to APSTA without restarting the STA.
+ *
+ * @return esp_err_t ESP_OK on success (also if the AP is already up),
+ *         ESP_ERR_INVALID_STATE if the active configuration has no AP.
+ */
+esp_err_t net_manager_ap_enable(void);
+
+/**
+ * @brief Takes the AP down at runtime and releases its netif and DHCP server.
+ *        The STA, if running, stays connected.
+ *
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t net_manager_ap_disable(void);
+
+/**
+ * @brief Sets the Wi-Fi STA power-save policy. Takes effect at once if the STA is running,
+ *        except the listen interval of LOW_POWER and AUTO, which the AP learns at the next
+ *        association. The policy is kept across net_manager_stop()/start().
+ *
+ * @param policy The policy; the default is set in Kconfig.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_SUPPORTED for NET_POWER_SAVE_AUTO if
+ *         CONFIG_NET_MANAGER_TRAFFIC_HOOKS_ENABLED is not set, or the error of
+ *         esp_wifi_set_ps() (WIFI_PS_NONE is refused while Wi-Fi shares the radio with Bluetooth).
+ */
+esp_err_t net_manager_set_power_save(net_power_save_t policy);
+
+/**
+ * @brief Gets the Wi-Fi STA power-save policy.
+ *
+ * @param[out] policy The policy set with net_manager_set_power_save().
+ * @param[out] low_power Optional. With NET_POWER_SAVE_AUTO, whether the STA is in the
+ *                       idle (low power) state; otherwise whether the policy is LOW_POWER.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t net_manager_get_power_save(net_power_save_t *policy, bool *low_power);
+
 /**
  * @brief Gets the current status of all network interfaces.
  *
@@ -179,8 +508,59 @@ bool net_manager_is_eth_connected(void);
  */
 esp_err_t net_manager_get_ap_clients_list(wifi_sta_list_t *clients);
 
+/**
+ * @brief Copies the soft-AP client table maintained from Wi-Fi/IP events.
+ *        Lock-free and without a driver call, safe to poll from any task.
+ *
+ * @param[out] clients Array to be filled with the clients.
+ * @param max_clients Capacity of the clients array.
+ * @param[out] num_clients Number of entries written.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t net_manager_get_ap_clients(net_ap_client_t *clients, size_t max_clients, size_t *num_clients);
+
+/**
+ * @brief Looks up one soft-AP client by MAC address. Lock-free.
+ *
+ * @param mac The client MAC address.
+ * @param[out] client Filled with the client entry.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if the client is not associated.
+ */
+esp_err_t net_manager_get_ap_client(const uint8_t mac[6], net_ap_client_t *client);
+
+/**
+ * @brief Copies the soft-AP DHCP lease table, including leases of clients that left
+ *        but have not expired yet.
+ *
+ * @param[out] leases Array to be filled with the leases.
+ * @param max_leases Capacity of the leases array.
+ * @param[out] num_leases Number of entries written.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t net_manager_get_ap_leases(net_ap_lease_t *leases, size_t max_leases, size_t *num_leases);
+
+/**
+ * @brief Gets the soft-AP admission control counters (join rate limiting, idle eviction).
+ *
+ * @param[out] stats Filled with the counters since the AP was started.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t net_manager_get_ap_admission_stats(net_ap_admission_stats_t *stats);
+
+/**
+ * @brief Gets the soft-AP client loss per STA roam. The AP announces channel moves with
+ *        channel switch announcements; clients that drop anyway have their reconnect time measured.
+ *
+ * @param[out] stats Filled with the counters since the AP was started.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if the AP is not running.
+ */
+esp_err_t net_manager_get_ap_roam_stats(net_ap_roam_stats_t *stats);
+
 /**
  * @brief Saves a network configuration to NVS (Non-Volatile Storage).
+ * @note The in-RAM copy is updated immediately; the NVS commit is deferred by
+ *       CONFIG_NET_MANAGER_CONFIG_COMMIT_DELAY_MS and coalesced with further saves.
+ *       Call net_manager_flush_config() before powering off.
  *
  * @param config Pointer to the configuration to save.
  * @return esp_err_t ESP_OK on success.
@@ -188,13 +568,41 @@ esp_err_t net_manager_get_ap_clients_list(wifi_sta_list_t *clients);
 esp_err_t net_manager_save_config_to_nvs(const net_manager_config_t *config);
 
 /**
- * @brief Loads a network configuration from NVS.
+ * @brief Loads a network configuration from NVS. Served from the in-RAM copy read at init.
  *
  * @param config Pointer to a structure to be filled with the loaded configuration.
  * @return esp_err_t ESP_OK on success, ESP_ERR_NVS_NOT_FOUND if no config is saved.
  */
 esp_err_t net_manager_load_config_from_nvs(net_manager_config_t *config);
 
+/**
+ * @brief Commits a pending config save to NVS now instead of after the write-behind delay.
+ *        Also done by net_manager_deinit().
+ *
+ * @return esp_err_t ESP_OK on success (also if nothing was pending).
+ */
+esp_err_t net_manager_flush_config(void);
+
+/**
+ * @brief Gets the NVS write counters. Each config section (enable flags, STA, AP, ETH) is
+ *        stored under its own key and only rewritten when it changed, so saving a new STA
+ *        password writes the STA section only.
+ *
+ * @param[out] stats Filled with the counters since init.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t net_manager_get_config_save_stats(net_config_save_stats_t *stats);
+
+/**
+ * @brief Gets the memory footprint report: the heap consumed by each phase of bringing up
+ *        Wi-Fi, the STA, the AP and Ethernet (sampled around the phase), the current heap
+ *        state, and the high-water marks of the component's own structures.
+ *
+ * @param[out] report Filled with the report.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t net_manager_get_memory_report(net_memory_report_t *report);
+
 /**
  * @brief Gets the IP information (IP, mask, gw) for a specific network interface.
  *
@@ -214,6 +622,91 @@ esp_err_t net_manager_get_ip_info(net_event_source_t source, esp_netif_ip_info_t
  */
 esp_err_t net_manager_get_dns_info(net_event_source_t source, esp_netif_dns_type_t type, esp_netif_dns_info_t *dns_info);
 
+/**
+ * @brief Binds a socket to the interface selected by a policy (SO_BINDTODEVICE).
+ *        The socket is tracked, and a NET_STATUS_BOUND_INTERFACE_LOST event carrying
+ *        the fd is dispatched when its interface goes down. The event data points to an
+ *        int on the stack of the dispatching task: read the fd during the callback
+ *        (`int fd = *(int *)event->data;`) and do not keep the pointer.
+ *
+ * @param fd The socket descriptor.
+ * @param policy Pointer to the binding policy.
+ * @param[out] bound_source Optional. Filled with the interface the socket was bound to.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if no suitable interface is connected,
+ *         ESP_ERR_NO_MEM if the bound socket table is full.
+ */
+esp_err_t net_manager_bind_socket(int fd, const net_bind_policy_t *policy, net_event_source_t *bound_source);
+
+/**
+ * @brief Stops tracking a socket bound with net_manager_bind_socket().
+ *        Call this before closing the socket.
+ *
+ * @param fd The socket descriptor.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if the socket is not tracked.
+ */
+esp_err_t net_manager_unbind_socket(int fd);
+
+/**
+ * @brief Feeds a round-trip time sample for an interface, used by NET_BIND_POLICY_LOWEST_RTT.
+ *        Samples are smoothed with an EWMA.
+ *
+ * @param source The interface the sample was measured on.
+ * @param rtt_ms The measured round-trip time in milliseconds.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t net_manager_report_rtt(net_event_source_t source, uint32_t rtt_ms);
+
+/**
+ * @brief Gets the smoothed round-trip time of an interface.
+ *
+ * @param source The interface to query.
+ * @param[out] rtt_ms Smoothed RTT in milliseconds.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if no sample is available.
+ */
+esp_err_t net_manager_get_rtt(net_event_source_t source, uint32_t *rtt_ms);
+
+/**
+ * @brief Resolves an IPv4 address through the net_manager DNS cache.
+ *        Lookups are timed to rank the DNS servers of the primary interface; when the
+ *        main server keeps failing or answering slowly it is swapped with the backup.
+ * @note Only lookups made through this function are cached and ranked. getaddrinfo(),
+ *       gethostbyname() and dns_gethostbyname() called directly go to lwIP unseen, though
+ *       they use the server order this function maintains.
+ * @note Answers are cached for CONFIG_NET_MANAGER_DNS_POSITIVE_TTL_S and names that do not
+ *       exist for CONFIG_NET_MANAGER_DNS_NEGATIVE_TTL_S, whatever the TTL of the record:
+ *       lwIP does not pass it up. A record that changes sooner is served stale until then;
+ *       net_manager_flush_dns_cache() drops it.
+ * @note lwIP does not report which server answered either, so that is inferred from the
+ *       time the answer took: within the resend window of the main server (about 6 s with
+ *       the lwIP defaults) the answer is counted for the main server, after it for the
+ *       backup. A main server answering its last resend is counted as failed, and the
+ *       backup's latency includes up to one DNS timer tick. A swap of the servers is kept
+ *       across DHCP renewals that offer the same two servers.
+ *
+ * @param hostname The host name to resolve.
+ * @param[out] addr Resolved IPv4 address.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if a server answered that the
+ *         name does not exist, ESP_ERR_TIMEOUT if no server answered,
+ *         ESP_ERR_INVALID_STATE if the primary interface has no DNS server.
+ */
+esp_err_t net_manager_resolve(const char *hostname, esp_ip4_addr_t *addr);
+
+/**
+ * @brief Drops all entries from the net_manager DNS cache.
+ *
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t net_manager_flush_dns_cache(void);
+
+/**
+ * @brief Gets the DNS server ranking and statistics of an interface.
+ *
+ * @param source The network interface (STA or ETH) to query.
+ * @param[out] stats Array of two entries; stats[0] is the server currently used as main.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG if interface is not active.
+ */
+esp_err_t net_manager_get_dns_stats(net_event_source_t source, net_dns_server_stats_t stats[2]);
+
 
 #ifdef __cplusplus
 }
@@ -3,24 +3,69 @@
  *
  */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
+#include <stdatomic.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "freertos/timers.h"
 #include "esp_log.h"
+#include "esp_check.h"
 #include "esp_wifi.h"
 #include "esp_eth.h"
 #include "esp_event.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include "nvs_flash.h"
 #include "sdkconfig.h"
 #include "ethernet_init.h"
+#include "lwip/sockets.h"
+#include "lwip/etharp.h"
+#include "lwip/netif.h"
+#include "lwip/netdb.h"
+#include "lwip/dns.h"
+#if CONFIG_NET_MANAGER_IPV6_ENABLED && LWIP_IPV6_DHCP6
+#include "lwip/dhcp6.h"
+#endif
+#if CONFIG_NET_MANAGER_RTT_PROBE_ENABLED
+#include "ping/ping_sock.h"
+#endif
+#if CONFIG_NET_MANAGER_FACTORY_CONFIG_ENABLED
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#endif
 
 #include "net_manager.h"
+#include "net_manager_config.h"
 
 /* --- Macros and Definitions --- */
 static const char *TAG = "NET_MANAGER";
 #define NVS_NAMESPACE "net_manager"
-#define NVS_CONFIG_KEY "net_config"
+#define NVS_CONFIG_KEY "net_config" // Whole-struct blob of the baseline firmware (legacy_config_v0_t)
+#define NVS_VERSION_KEY "cfg_ver"
+#define NVS_CONFIG_VERSION_RAW 1 // Sections stored as raw structs of the frozen v1 layouts
+#define NVS_CONFIG_VERSION 2     // Sections stored as tag-length-value records
+#define NVS_SLOT_KEY "cfg_slot"   // Slot holding the last-known-good config
+#define NVS_TRIAL_KEY "cfg_trial" // Slot holding a config on trial, absent if none
+#define NVS_SLOT_COUNT 2          // Slot 0 uses the plain section keys, slot 1 prefixes them with 'b'
+#define NVS_KEY_LEN 16
+#define FACTORY_CONFIG_MAGIC 0x43464D4E // "NMFC"
+#define NET_SOURCE_COUNT 3
+#define DHCPS_DEFAULT_LEASE_TIME_MIN 120 // ESP-IDF DHCP server default
+#define RTT_EWMA_WEIGHT 8 // New samples contribute 1/8 to the smoothed RTT
+#define GW_PREWARM_POLL_MS 10
+// lwIP resends a query after 1, 1, 2, 3... DNS timer ticks and moves on to the backup
+// server after DNS_MAX_RETRIES sends. It reports neither which server answered nor whether
+// a failure was an answer or a timeout, so both are inferred from the elapsed time. The
+// first tick comes up to one interval early, as the DNS timer is shared.
+#define DNS_SERVER_WINDOW_MS (DNS_TMR_INTERVAL * (1 + (DNS_MAX_RETRIES - 1) * DNS_MAX_RETRIES / 2))
+#define DNS_SERVER_SWITCH_MS (DNS_SERVER_WINDOW_MS - DNS_TMR_INTERVAL)
+#define WORKER_QUEUE_LEN 8
+#define WIFI_CHANNEL_MAX 13
 
 /* --- Internal State Variables --- */
 
@@ -35,12 +80,253 @@ static esp_netif_t *s_netif_eth = NULL;
 
 static esp_eth_handle_t *s_eth_handles = NULL;
 static uint8_t s_eth_handles_num = 0;
+static esp_eth_netif_glue_handle_t s_eth_glue = NULL;
+// RX task names of the MAC drivers ethernet_init can install (internal EMAC, SPI modules)
+static const char *const s_eth_rx_task_names[] = {"emac_rx", "w5500_tsk", "dm9051_tsk", "ksz8851snl_tsk"};
+
+// Timers, one slot each in the static allocation arena
+typedef enum {
+    NM_TIMER_AP_CHANNEL,
+    NM_TIMER_AP_OFF,
+    NM_TIMER_AP_ON,
+    NM_TIMER_CONFIG_COMMIT,
+    NM_TIMER_CONFIG_TRIAL,
+    NM_TIMER_PS_IDLE,
+    NM_TIMER_GW_PREWARM,
+    NM_TIMER_COUNT,
+} nm_timer_slot_t;
+
+// Deferred work, run by the worker task with the component mutex held
+typedef enum {
+    NET_WORK_EXIT,
+    NET_WORK_AP_CHANNEL_SELECT,
+    NET_WORK_AP_CHANNEL_REEVAL,
+    NET_WORK_AP_SUSPEND,
+    NET_WORK_AP_RESUME,
+    NET_WORK_CONFIG_COMMIT,
+    NET_WORK_CONFIG_ROLLBACK,
+    NET_WORK_PS_IDLE,
+    NET_WORK_PS_WAKE,
+    NET_WORK_GW_PREWARM,
+} net_work_id_t;
+static QueueHandle_t s_work_queue = NULL;
+static TaskHandle_t s_work_task = NULL;
+static SemaphoreHandle_t s_work_exited = NULL;
+
+#if CONFIG_NET_MANAGER_STATIC_ALLOCATION
+// Backing storage of every FreeRTOS object net_manager creates, nothing comes from the heap.
+// Static timers are never deleted (a deleted timer's buffer stays in use until the timer
+// task processes the command); timer_release() stops them and timer_create() reuses them.
+static struct {
+    StaticSemaphore_t mutex;
+    StaticSemaphore_t work_exited;
+    StaticQueue_t work_queue;
+    uint8_t work_queue_storage[WORKER_QUEUE_LEN * sizeof(net_work_id_t)];
+    StaticTask_t work_task;
+    StackType_t work_stack[CONFIG_NET_MANAGER_WORKER_STACK_SIZE];
+    StaticTimer_t timers[NM_TIMER_COUNT];
+    TimerHandle_t timer_handles[NM_TIMER_COUNT];
+} s_arena;
+#endif
 
 // Status tracking
 static net_manager_status_t s_status;
 static net_event_callback_t s_user_callback = NULL;
 static int s_sta_retry_count = 0;
 
+// Socket binding
+typedef struct {
+    int fd;
+    net_event_source_t source;
+    bool in_use;
+} bound_socket_t;
+static bound_socket_t s_bound_sockets[CONFIG_NET_MANAGER_MAX_BOUND_SOCKETS];
+static uint32_t s_rtt_ms[NET_SOURCE_COUNT]; // Smoothed RTT per source, 0 = no sample yet
+#if CONFIG_NET_MANAGER_RTT_PROBE_ENABLED
+static esp_ping_handle_t s_rtt_probe[NET_SOURCE_COUNT];
+#endif
+#if CONFIG_NET_MANAGER_GW_PREWARM_ENABLED
+// CONNECTED/ADDRESS_CHANGED held back per source until the gateway MAC is resolved
+typedef struct {
+    bool pending;
+    bool address_changed;
+    int64_t start_us;
+} gw_prewarm_wait_t;
+static gw_prewarm_wait_t s_gw_wait[NET_SOURCE_COUNT];
+static TimerHandle_t s_gw_prewarm_timer = NULL;
+#endif
+
+// DNS resolver management
+typedef struct {
+    net_dns_server_stats_t servers[2]; // servers[0] is applied as ESP_NETIF_DNS_MAIN
+    uint8_t consecutive_bad;           // Slow or unanswered lookups in a row on servers[0]
+} dns_state_t;
+typedef struct {
+    char hostname[CONFIG_NET_MANAGER_DNS_CACHE_NAME_LEN];
+    esp_ip4_addr_t addr;
+    TickType_t expires;
+    bool negative;
+    bool in_use;
+} dns_cache_entry_t;
+static dns_state_t s_dns[NET_SOURCE_COUNT];
+static dns_cache_entry_t s_dns_cache[CONFIG_NET_MANAGER_DNS_CACHE_SIZE];
+static esp_netif_t *s_dns_primary_netif = NULL;
+
+// Soft-AP client table: open addressing keyed by MAC, written under the component
+// mutex, read lock-free through the s_ap_clients_seq sequence counter (seqlock).
+typedef struct {
+    net_ap_client_t client;
+    uint8_t stats_idx; // Slot in s_ap_client_traffic, fixed while the table reorders
+    bool in_use;
+} ap_client_slot_t;
+static ap_client_slot_t s_ap_clients[CONFIG_NET_MANAGER_AP_CLIENT_TABLE_SIZE];
+static atomic_uint s_ap_clients_seq;
+
+// Soft-AP admission control: join token bucket and idle eviction
+static uint8_t s_ap_max_clients = 0; // Policy limit, the driver limit is one higher when eviction is on
+static uint32_t s_ap_join_tokens = 0;
+static int64_t s_ap_join_refill_us = 0;
+static net_ap_admission_stats_t s_ap_admission;
+
+// Soft-AP DHCP leases, outlive the association until they expire
+typedef struct {
+    net_ap_lease_t lease;
+    bool in_use;
+} ap_lease_slot_t;
+static ap_lease_slot_t s_ap_leases[CONFIG_NET_MANAGER_AP_LEASE_TABLE_SIZE];
+static uint32_t s_ap_lease_time_min = DHCPS_DEFAULT_LEASE_TIME_MIN;
+
+// Soft-AP automatic channel selection (channel = 0)
+static bool s_ap_auto_channel = false;
+static uint32_t s_ap_generation = 0; // Bumped per AP netif, detects an AP restarted during a scan
+static uint32_t s_wifi_mode_generation = 0; // Bumped per Wi-Fi mode change, see wifi_set_mode()
+static TimerHandle_t s_ap_channel_timer = NULL;
+
+// APSTA channel follow: the AP moves when the STA roams to a BSS on another channel.
+// Clients that drop within the window after a move are tracked until they rejoin.
+typedef struct {
+    uint8_t mac[6];
+    bool in_use;
+} ap_roam_lost_t;
+static uint8_t s_ap_channel = 0;
+static int64_t s_ap_roam_start_us = 0; // 0 = no channel move in progress
+static ap_roam_lost_t s_ap_roam_lost[CONFIG_NET_MANAGER_AP_CLIENT_TABLE_SIZE];
+static net_ap_roam_stats_t s_ap_roam;
+static uint64_t s_ap_rejoin_ms_total = 0;
+
+// NVS persistence: one key per config section (see net_manager_config.h for the encoding).
+// s_nvs_config mirrors what is stored so unchanged sections are not rewritten.
+static net_manager_config_t s_nvs_config[NVS_SLOT_COUNT];
+static bool s_nvs_config_valid[NVS_SLOT_COUNT];
+static net_config_save_stats_t s_nvs_save_stats;
+
+// Authoritative config, loaded from NVS once at init. Saves only update it and mark it
+// dirty; the worker commits it to NVS after CONFIG_NET_MANAGER_CONFIG_COMMIT_DELAY_MS.
+static net_manager_config_t s_config;
+static bool s_config_stored = false; // s_config holds a saved config (not just zeros)
+static bool s_config_dirty = false;
+static TimerHandle_t s_config_commit_timer = NULL;
+static uint8_t s_config_slot = 0; // NVS slot s_config is committed to
+
+// A/B config trial: net_manager_apply_config() writes the other slot and runs it until an
+// uplink connects (confirm) or CONFIG_NET_MANAGER_CONFIG_TRIAL_TIMEOUT_S expires (rollback).
+static net_manager_config_t s_trial_config;
+static bool s_trial_pending = false; // Trial found in NVS at init, runs on net_manager_start(NULL)
+static bool s_trial_active = false;
+static bool s_trial_saved = false; // net_manager_save_config() ran during the trial
+static TimerHandle_t s_trial_timer = NULL;
+
+// Config the interfaces currently run, the base of the diff in net_manager_activate_profile()
+static net_manager_config_t s_running_config;
+
+// Named profiles: one NVS key per profile ("p_<name>", whole config in the factory payload
+// format) plus an index of the names in use.
+#define NVS_PROFILE_INDEX_KEY "prof_idx"
+typedef char profile_name_t[NET_MANAGER_PROFILE_NAME_MAX + 1];
+static uint8_t s_config_buf[NM_CONFIG_SECTION_BUF_SIZE * NM_CONFIG_SECTION_COUNT]; // Whole-config encode/decode, used under the lock
+
+// On-demand AP: declared at start, allocated by net_manager_ap_enable()
+static bool s_ap_declared = false;
+static net_config_wifi_ap_t s_ap_config;
+
+// Provisioning AP policy: suspend the AP once the STA uplink is stable, resume on loss
+static uint16_t s_ap_auto_off_delay_s = 0;
+static uint16_t s_ap_auto_on_delay_s = 0;
+static uint8_t s_ap_auto_on_failed_retries = 0;
+static TimerHandle_t s_ap_off_timer = NULL;
+static TimerHandle_t s_ap_on_timer = NULL;
+
+// Last IPv4 address per source, kept across IP loss to detect address changes
+static esp_ip4_addr_t s_last_ip4[NET_SOURCE_COUNT];
+
+// Memory footprint: heap consumed by each bring-up phase, see net_manager_get_memory_report()
+typedef struct {
+    size_t internal_free;
+    size_t internal_largest;
+    size_t spiram_free;
+    size_t spiram_largest;
+} mem_sample_t;
+static net_mem_phase_cost_t s_mem_phases[NET_MEM_PHASE_MAX];
+static atomic_uint s_work_queue_peak;
+
+// Traffic hooks: the lwIP input and linkoutput functions of a netif are interposed to see
+// its frames without polling. The originals stay here so a late frame is still forwarded.
+typedef struct {
+    struct netif *netif;
+    netif_input_fn input;
+    netif_linkoutput_fn linkoutput;
+} traffic_hook_t;
+#if CONFIG_NET_MANAGER_TRAFFIC_HOOKS_ENABLED
+static traffic_hook_t s_traffic_hooks[NET_SOURCE_COUNT];
+#endif
+
+// Traffic counters of one direction of a source. Each has a single writer (the RX task of
+// the interface, or the TCP/IP task for TX) and is read lock-free through its sequence
+// counter, like the AP client table: 64-bit atomics are not lock-free on these targets.
+typedef struct {
+    atomic_uint seq;
+    uint64_t bytes;
+    uint32_t packets;
+    uint32_t dropped; // RX: refused by the TCP/IP input queue; TX: refused by the driver
+} traffic_counter_t;
+enum { TRAFFIC_RX, TRAFFIC_TX, TRAFFIC_DIRS };
+static traffic_counter_t s_traffic[NET_SOURCE_COUNT][TRAFFIC_DIRS];
+
+// Per-client byte counts of the soft-AP, written by its traffic hooks like s_traffic.
+// A client keeps its stats slot from join to leave; backward-shift deletion in the
+// client table never moves the counters a hook may be writing.
+typedef struct {
+    atomic_uint seq;
+    uint64_t bytes;
+    int64_t last_us; // esp_timer time of the last counted frame
+} ap_client_counter_t;
+static ap_client_counter_t s_ap_client_traffic[CONFIG_NET_MANAGER_AP_CLIENT_TABLE_SIZE][TRAFFIC_DIRS];
+
+// Wi-Fi STA power save. In AUTO mode the idle timer drops the STA to low power once the
+// traffic hooks have seen nothing for a while, and the next transmitted frame wakes it.
+#define STA_BEACON_TIMEOUT_DEFAULT_S 6
+#if CONFIG_NET_MANAGER_PS_MAX_PERF
+#define PS_POLICY_DEFAULT NET_POWER_SAVE_MAX_PERF
+#elif CONFIG_NET_MANAGER_PS_LOW_POWER
+#define PS_POLICY_DEFAULT NET_POWER_SAVE_LOW_POWER
+#elif CONFIG_NET_MANAGER_PS_AUTO
+#define PS_POLICY_DEFAULT NET_POWER_SAVE_AUTO
+#else
+#define PS_POLICY_DEFAULT NET_POWER_SAVE_BALANCED
+#endif
+static net_power_save_t s_ps_policy = PS_POLICY_DEFAULT;
+static TimerHandle_t s_ps_idle_timer = NULL;
+static atomic_bool s_ps_low_power;    // AUTO mode is in its idle (low power) state
+static atomic_uint s_sta_activity_ms; // esp_timer time of the last STA frame, in ms
+
+// Pointers into s_status for one interface, see iface_from_netif()
+typedef struct {
+    net_event_source_t source;
+    net_status_t *status;
+    esp_netif_ip_info_t *ip_info;
+    net_ip6_info_t *ip6_info;
+} iface_state_t;
+
 /* --- Thread Safety Macros --- */
 #define LOCK() \
     do         \
@@ -52,9 +338,94 @@ static int s_sta_retry_count = 0;
 static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
 static esp_err_t start_sta(const net_config_wifi_sta_t *sta_config);
 static esp_err_t start_ap(const net_config_wifi_ap_t *ap_config);
+static esp_err_t create_ap_netif(const net_config_wifi_ap_t *ap_config);
+static esp_err_t configure_ap(const net_config_wifi_ap_t *ap_config);
+static void ap_post_start(void);
+static esp_err_t ap_runtime_start(void);
+static void ap_runtime_stop(void);
+static void stop_source_tracking(net_event_source_t source);
 static esp_err_t start_eth(const net_config_ethernet_t *eth_config); // ETH config is from Kconfig
 static void stop_all_interfaces(void);
+static void stop_eth(void);
+static void eth_release(void);
+static void stop_wifi(void);
 static void get_default_config_from_kconfig(net_manager_config_t *config);
+static void get_default_config(net_manager_config_t *config);
+static esp_netif_t *netif_from_source(net_event_source_t source);
+static void notify_bound_interface_lost(net_event_source_t source);
+static void rtt_probe_start(net_event_source_t source, const esp_netif_ip_info_t *ip_info);
+static void rtt_probe_stop(net_event_source_t source);
+static bool gateway_prewarm(esp_netif_t *netif);
+static bool gw_prewarm_defer(net_event_source_t source, bool address_changed);
+static void gw_prewarm_cancel(net_event_source_t source);
+static void gw_prewarm_poll(void);
+static void dispatch_event(const net_manager_event_t *event);
+static void reannounce_after_failover(net_event_source_t lost_source);
+static void dns_capture_servers(net_event_source_t source);
+static void dns_apply_servers(net_event_source_t source);
+static void dns_check_primary_change(void);
+static void dns_reset(void);
+static bool ap_admit_client(const wifi_event_ap_staconnected_t *event);
+static void ap_client_join(const wifi_event_ap_staconnected_t *event);
+static void ap_roam_begin(uint8_t sta_channel);
+static bool ap_roam_window_open(void);
+static void ap_roam_client_lost(const uint8_t mac[6]);
+static void ap_roam_client_rejoined(const uint8_t mac[6]);
+static bool ap_client_leave(const uint8_t mac[6]);
+static void ap_evict_idle_client(const uint8_t joining_mac[6]);
+static void ap_client_snapshot(const ap_client_slot_t *slot, net_ap_client_t *client);
+static uint32_t ap_client_set_ip(const uint8_t mac[6], esp_ip4_addr_t ip);
+static void ap_lease_record(const uint8_t mac[6], esp_ip4_addr_t ip, uint32_t join_to_ip_ms);
+static esp_err_t apply_ap_dhcp_config(const net_config_wifi_ap_t *ap_config);
+static esp_err_t nvs_read_config(nvs_handle_t nvs_handle, uint8_t slot, net_manager_config_t *config);
+static esp_err_t nvs_write_config(nvs_handle_t nvs_handle, uint8_t slot, const net_manager_config_t *config);
+static esp_err_t load_config(net_manager_config_t *config);
+static esp_err_t config_commit(void);
+static esp_err_t config_store(const net_manager_config_t *config);
+static esp_err_t config_commit_schedule(void);
+static void config_commit_timer_cb(TimerHandle_t timer);
+static esp_err_t start_interfaces(const net_manager_config_t *cfg);
+static esp_err_t start_wifi(const net_manager_config_t *cfg);
+static void config_trial_arm(void);
+static void config_trial_clear(bool promote);
+static void config_trial_end(bool confirmed);
+static void config_trial_timer_cb(TimerHandle_t timer);
+static void worker_task(void *arg);
+static bool post_work(net_work_id_t work);
+static void mem_sample(mem_sample_t *sample);
+static void mem_phase_end(net_mem_phase_t phase, const mem_sample_t *before);
+static void wifi_buffers_resolve(const net_manager_config_t *cfg, net_wifi_buffers_t *buffers);
+static esp_err_t wifi_driver_init(const net_manager_config_t *cfg);
+static esp_err_t wifi_driver_start(void);
+static esp_err_t traffic_hook_install(void *ctx);
+static esp_err_t traffic_hook_remove(void *ctx);
+static esp_err_t eth_driver_install(const net_config_ethernet_t *eth_config);
+static void eth_driver_uninstall(void);
+static void eth_tune(const net_config_ethernet_t *eth_config);
+static uint16_t ps_listen_interval(net_power_save_t policy);
+static esp_err_t ps_apply(void);
+static void ps_auto_switch(bool low_power);
+static TimerHandle_t timer_create(nm_timer_slot_t slot, const char *name, TickType_t period, UBaseType_t auto_reload,
+                                  void *timer_id, TimerCallbackFunction_t callback);
+static void timer_release(TimerHandle_t *timer);
+#if CONFIG_NET_MANAGER_AP_AUTO_CHANNEL_REEVAL_S > 0
+static void ap_channel_timer_cb(TimerHandle_t timer);
+#endif
+static void ap_auto_channel_select(bool only_if_better);
+static esp_err_t wifi_set_mode(wifi_mode_t mode);
+static void ap_policy_init(const net_config_wifi_ap_t *ap_config);
+static void ap_policy_evaluate(void);
+static void ap_policy_apply(bool suspend);
+static void ap_client_set_rssi(const uint8_t mac[6], int8_t rssi);
+static void ap_clients_clear(void);
+static void ip6_start(esp_netif_t *netif);
+static bool iface_from_netif(esp_netif_t *netif, iface_state_t *iface);
+static bool ip6_refresh_info(esp_netif_t *netif, net_ip6_info_t *info);
+static bool handle_got_ip(const ip_event_got_ip_t *event, net_manager_event_t *event_to_dispatch);
+static void iface_connected(const iface_state_t *iface, bool was_connected, bool address_changed,
+                            net_manager_event_t *event_to_dispatch);
+static bool handle_lost_ip(const ip_event_got_ip_t *event, net_manager_event_t *event_to_dispatch);
+static bool handle_got_ip6(const ip_event_got_ip6_t *event, net_manager_event_t *event_to_dispatch);
 // static void apply_static_ip_config(esp_netif_t *netif, const esp_netif_ip_info_t *ip_info, const esp_ip4_addr_t *dns1, const esp_ip4_addr_t *dns2);
 
 /**
@@ -75,6 +446,11 @@ static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_
         {
         // --- Station Events ---
         case WIFI_EVENT_STA_START:
+            if (!s_netif_sta)
+            {
+                UNLOCK();
+                return; // AP channel scan, see ap_auto_channel_select()
+            }
             ESP_LOGI(TAG, "STA Start: connecting...");
             s_status.sta_status = NET_STATUS_CONNECTING;
             esp_wifi_connect();
@@ -85,9 +461,14 @@ static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_
         {
             int max_retries = CONFIG_NET_MANAGER_STA_RECONNECT_ATTEMPTS;
             s_status.sta_status = NET_STATUS_DISCONNECTED;
+            memset(&s_status.sta_ip6_info, 0, sizeof(s_status.sta_ip6_info));
             event_to_dispatch = (net_manager_event_t){.source = NET_EVENT_SOURCE_STA, .status = NET_STATUS_DISCONNECTED};
             if (s_user_callback)
                 s_user_callback(&event_to_dispatch); // Notify disconnect immediately
+            rtt_probe_stop(NET_EVENT_SOURCE_STA);
+            gw_prewarm_cancel(NET_EVENT_SOURCE_STA);
+            notify_bound_interface_lost(NET_EVENT_SOURCE_STA);
+            reannounce_after_failover(NET_EVENT_SOURCE_STA);
 
             if (max_retries < 0 || s_sta_retry_count < max_retries)
             {
@@ -105,6 +486,16 @@ static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_
             break;
         }
 
+        case WIFI_EVENT_STA_CONNECTED:
+        {
+            // Associated, waiting for IP. Link-local IPv6 needs the link to be up.
+            wifi_event_sta_connected_t *event = (wifi_event_sta_connected_t *)event_data;
+            ap_roam_begin(event->channel);
+            ip6_start(s_netif_sta);
+            UNLOCK();
+            return;
+        }
+
         // --- Access Point Events ---
         case WIFI_EVENT_AP_START:
             ESP_LOGI(TAG, "AP Started.");
@@ -116,13 +507,22 @@ static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_
         case WIFI_EVENT_AP_STOP:
             ESP_LOGI(TAG, "AP Stopped.");
             s_status.ap_status = NET_STATUS_STOPPED;
+            ap_clients_clear();
+            notify_bound_interface_lost(NET_EVENT_SOURCE_AP);
             event_to_dispatch = (net_manager_event_t){.source = NET_EVENT_SOURCE_AP, .status = NET_STATUS_STOPPED};
             break;
 
         case WIFI_EVENT_AP_STACONNECTED:
         {
             wifi_event_ap_staconnected_t *event = (wifi_event_ap_staconnected_t *)event_data;
-            s_status.ap_connected_clients++;
+            if (!ap_admit_client(event))
+            {
+                UNLOCK();
+                return;
+            }
+            ap_client_join(event);
+            ap_roam_client_rejoined(event->mac);
+            ap_evict_idle_client(event->mac);
             // ESP_LOGI(TAG, "AP Client Connected: "MACSTR", AID=%d. Total clients: %d", MAC2STR(event->mac), event->aid, s_status.ap_connected_clients);
             event_to_dispatch = (net_manager_event_t){.source = NET_EVENT_SOURCE_AP, .status = NET_STATUS_CLIENT_CONNECTED, .data = event};
             break;
@@ -131,12 +531,26 @@ static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_
         case WIFI_EVENT_AP_STADISCONNECTED:
         {
             wifi_event_ap_stadisconnected_t *event = (wifi_event_ap_stadisconnected_t *)event_data;
-            s_status.ap_connected_clients--;
+            if (!ap_client_leave(event->mac))
+            {
+                UNLOCK();
+                return; // Refused or unknown (e.g. joined before a restart)
+            }
+            if (ap_roam_window_open())
+                ap_roam_client_lost(event->mac);
             // ESP_LOGI(TAG, "AP Client Disconnected: "MACSTR", AID=%d. Total clients: %d", MAC2STR(event->mac), event->aid, s_status.ap_connected_clients);
             event_to_dispatch = (net_manager_event_t){.source = NET_EVENT_SOURCE_AP, .status = NET_STATUS_CLIENT_DISCONNECTED, .data = event};
             break;
         }
 
+        case WIFI_EVENT_AP_PROBEREQRECVED:
+        {
+            wifi_event_ap_probe_req_rx_t *event = (wifi_event_ap_probe_req_rx_t *)event_data;
+            ap_client_set_rssi(event->mac, (int8_t)event->rssi);
+            UNLOCK();
+            return;
+        }
+
         default:
             UNLOCK();
             return; // Don't dispatch unhandled events
@@ -147,23 +561,30 @@ static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_
         /****************/
         /*  IP Events   */
         /****************/
-        ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
-        if (event->esp_netif == s_netif_sta)
+        bool dispatch = false;
+        switch (event_id)
         {
-            ESP_LOGI(TAG, "STA Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
-            s_sta_retry_count = 0;
-            s_status.sta_status = NET_STATUS_CONNECTED;
-            memcpy(&s_status.sta_ip_info, &event->ip_info, sizeof(esp_netif_ip_info_t));
-            event_to_dispatch = (net_manager_event_t){.source = NET_EVENT_SOURCE_STA, .status = NET_STATUS_CONNECTED, .data = &event->ip_info};
-        }
-        else if (event->esp_netif == s_netif_eth)
+        case IP_EVENT_GOT_IP6:
+            dispatch = handle_got_ip6((ip_event_got_ip6_t *)event_data, &event_to_dispatch);
+            break;
+        case IP_EVENT_STA_GOT_IP:
+        case IP_EVENT_ETH_GOT_IP:
+            dispatch = handle_got_ip((ip_event_got_ip_t *)event_data, &event_to_dispatch);
+            break;
+        case IP_EVENT_STA_LOST_IP:
+        case IP_EVENT_ETH_LOST_IP:
+            dispatch = handle_lost_ip((ip_event_got_ip_t *)event_data, &event_to_dispatch);
+            break;
+        case IP_EVENT_AP_STAIPASSIGNED:
         {
-            ESP_LOGI(TAG, "ETH Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
-            s_status.eth_status = NET_STATUS_CONNECTED;
-            memcpy(&s_status.eth_ip_info, &event->ip_info, sizeof(esp_netif_ip_info_t));
-            event_to_dispatch = (net_manager_event_t){.source = NET_EVENT_SOURCE_ETHERNET, .status = NET_STATUS_CONNECTED, .data = &event->ip_info};
+            ip_event_ap_staipassigned_t *event = (ip_event_ap_staipassigned_t *)event_data;
+            ap_lease_record(event->mac, event->ip, ap_client_set_ip(event->mac, event->ip));
+            break;
         }
-        else
+        default:
+            break;
+        }
+        if (!dispatch)
         {
             UNLOCK();
             return;
@@ -178,12 +599,18 @@ static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_
         {
         case ETHERNET_EVENT_CONNECTED:
             ESP_LOGI(TAG, "ETH Link Up");
+            ip6_start(s_netif_eth);
             s_status.eth_status = NET_STATUS_CONNECTING; // Link up, waiting for IP
             event_to_dispatch = (net_manager_event_t){.source = NET_EVENT_SOURCE_ETHERNET, .status = NET_STATUS_CONNECTING};
             break;
         case ETHERNET_EVENT_DISCONNECTED:
             ESP_LOGW(TAG, "ETH Link Down");
             s_status.eth_status = NET_STATUS_DISCONNECTED;
+            memset(&s_status.eth_ip6_info, 0, sizeof(s_status.eth_ip6_info));
+            rtt_probe_stop(NET_EVENT_SOURCE_ETHERNET);
+            gw_prewarm_cancel(NET_EVENT_SOURCE_ETHERNET);
+            notify_bound_interface_lost(NET_EVENT_SOURCE_ETHERNET);
+            reannounce_after_failover(NET_EVENT_SOURCE_ETHERNET);
             event_to_dispatch = (net_manager_event_t){.source = NET_EVENT_SOURCE_ETHERNET, .status = NET_STATUS_DISCONNECTED};
             break;
         case ETHERNET_EVENT_START:
@@ -194,6 +621,9 @@ static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_
         case ETHERNET_EVENT_STOP:
             ESP_LOGI(TAG, "ETH Stopped");
             s_status.eth_status = NET_STATUS_STOPPED;
+            rtt_probe_stop(NET_EVENT_SOURCE_ETHERNET);
+            gw_prewarm_cancel(NET_EVENT_SOURCE_ETHERNET);
+            notify_bound_interface_lost(NET_EVENT_SOURCE_ETHERNET);
             event_to_dispatch = (net_manager_event_t){.source = NET_EVENT_SOURCE_ETHERNET, .status = NET_STATUS_STOPPED};
             break;
         default:
@@ -207,11 +637,27 @@ static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_
         return;
     }
 
+    dispatch_event(&event_to_dispatch);
+    UNLOCK();
+}
+
+/**
+ * @brief Runs the follow-ups of a status change and notifies the user.
+ *        Must be called with the lock held.
+ */
+static void dispatch_event(const net_manager_event_t *event)
+{
+    dns_check_primary_change();
+    ap_policy_evaluate();
+
     if (s_user_callback)
     {
-        s_user_callback(&event_to_dispatch);
+        s_user_callback(event);
     }
-    UNLOCK();
+
+    // A config on trial is confirmed by the first uplink (STA/ETH) that connects.
+    if (s_trial_active && event->status == NET_STATUS_CONNECTED && event->source != NET_EVENT_SOURCE_AP)
+        config_trial_end(true);
 }
 
 /**
@@ -221,23 +667,24 @@ static esp_err_t start_sta(const net_config_wifi_sta_t *sta_config)
 {
     s_netif_sta = esp_netif_create_default_wifi_sta();
     assert(s_netif_sta);
+    esp_netif_tcpip_exec(traffic_hook_install, (void *)(intptr_t)NET_EVENT_SOURCE_STA);
 
     // Apply static IP if configured
     if (sta_config->use_static_ip)
     {
         ESP_LOGI(TAG, "Using static IP for Wi-Fi STA");
-        ESP_ERROR_CHECK(esp_netif_dhcpc_stop(s_netif_sta));
-        ESP_ERROR_CHECK(esp_netif_set_ip_info(s_netif_sta, &sta_config->ip_info));
+        ESP_RETURN_ON_ERROR(esp_netif_dhcpc_stop(s_netif_sta), TAG, "DHCP client stop failed");
+        ESP_RETURN_ON_ERROR(esp_netif_set_ip_info(s_netif_sta, &sta_config->ip_info), TAG, "Static IP failed");
 
         if (sta_config->dns1.addr != 0)
         {
             esp_netif_dns_info_t dns_info_1 = {.ip.u_addr.ip4 = sta_config->dns1};
-            ESP_ERROR_CHECK(esp_netif_set_dns_info(s_netif_sta, ESP_NETIF_DNS_MAIN, &dns_info_1));
+            ESP_RETURN_ON_ERROR(esp_netif_set_dns_info(s_netif_sta, ESP_NETIF_DNS_MAIN, &dns_info_1), TAG, "DNS server config failed");
         }
         if (sta_config->dns2.addr != 0)
         {
             esp_netif_dns_info_t dns_info_2 = {.ip.u_addr.ip4 = sta_config->dns2};
-            ESP_ERROR_CHECK(esp_netif_set_dns_info(s_netif_sta, ESP_NETIF_DNS_BACKUP, &dns_info_2));
+            ESP_RETURN_ON_ERROR(esp_netif_set_dns_info(s_netif_sta, ESP_NETIF_DNS_BACKUP, &dns_info_2), TAG, "DNS server config failed");
         }
     }
     else
@@ -251,12 +698,13 @@ static esp_err_t start_sta(const net_config_wifi_sta_t *sta_config)
             .sort_method = WIFI_CONNECT_AP_BY_SIGNAL,
             .threshold.rssi = -127,
             .threshold.authmode = WIFI_AUTH_OPEN,
+            .listen_interval = ps_listen_interval(s_ps_policy), // Only used by WIFI_PS_MAX_MODEM
         },
     };
     strncpy((char *)wifi_cfg.sta.ssid, sta_config->ssid, sizeof(wifi_cfg.sta.ssid));
     strncpy((char *)wifi_cfg.sta.password, sta_config->password, sizeof(wifi_cfg.sta.password));
 
-    ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, &wifi_cfg));
+    ESP_RETURN_ON_ERROR(esp_wifi_set_config(ESP_IF_WIFI_STA, &wifi_cfg), TAG, "Wi-Fi config failed");
     ESP_LOGI(TAG, "Wi-Fi STA configured for SSID: %s", sta_config->ssid);
     return ESP_OK;
 }
@@ -265,21 +713,67 @@ static esp_err_t start_sta(const net_config_wifi_sta_t *sta_config)
  * @brief Initializes and configures Wi-Fi AP interface.
  */
 static esp_err_t start_ap(const net_config_wifi_ap_t *ap_config)
+{
+    esp_err_t err = create_ap_netif(ap_config);
+    if (err != ESP_OK)
+        return err;
+    return configure_ap(ap_config);
+}
+
+/**
+ * @brief Creates the AP netif and configures its DHCP server. Needs no Wi-Fi mode, so it
+ *        can run before the AP is switched on and catch its AP_START event.
+ */
+static esp_err_t create_ap_netif(const net_config_wifi_ap_t *ap_config)
 {
     s_netif_ap = esp_netif_create_default_wifi_ap();
     assert(s_netif_ap);
+    s_ap_generation++;
+    esp_netif_tcpip_exec(traffic_hook_install, (void *)(intptr_t)NET_EVENT_SOURCE_AP);
+    esp_err_t err = apply_ap_dhcp_config(ap_config);
+
+    // Admission control state. With idle eviction the driver admits one client over the
+    // policy limit, so a newcomer can take the slot of the longest-idle client.
+    s_ap_max_clients = ap_config->max_connections;
+    s_ap_join_tokens = CONFIG_NET_MANAGER_AP_JOIN_BURST;
+    s_ap_join_refill_us = esp_timer_get_time();
+    memset(&s_ap_admission, 0, sizeof(s_ap_admission));
+    memset(&s_ap_roam, 0, sizeof(s_ap_roam));
+    memset(s_ap_roam_lost, 0, sizeof(s_ap_roam_lost));
+    s_ap_roam_start_us = 0;
+    s_ap_rejoin_ms_total = 0;
+    return err;
+}
+
+/**
+ * @brief Applies the AP Wi-Fi configuration. The Wi-Fi mode must include the AP.
+ */
+static esp_err_t configure_ap(const net_config_wifi_ap_t *ap_config)
+{
+    uint8_t driver_max_connections = ap_config->max_connections;
+#if CONFIG_NET_MANAGER_AP_IDLE_EVICTION_ENABLED
+    if (driver_max_connections < ESP_WIFI_MAX_CONN_NUM)
+        driver_max_connections++;
+#endif
 
+    // Channel 0 selects the least congested channel once Wi-Fi is running.
+    s_ap_auto_channel = (ap_config->channel == 0);
     wifi_config_t wifi_cfg = {
         .ap = {
-            .channel = ap_config->channel,
-            .max_connection = ap_config->max_connections,
+            .channel = s_ap_auto_channel ? 1 : ap_config->channel,
+            .max_connection = driver_max_connections,
+            .csa_count = CONFIG_NET_MANAGER_AP_CSA_COUNT,
             .authmode = (strlen(ap_config->password) == 0) ? WIFI_AUTH_OPEN : WIFI_AUTH_WPA2_PSK,
         },
     };
     strncpy((char *)wifi_cfg.ap.ssid, ap_config->ssid, sizeof(wifi_cfg.ap.ssid));
     strncpy((char *)wifi_cfg.ap.password, ap_config->password, sizeof(wifi_cfg.ap.password));
 
-    ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_AP, &wifi_cfg));
+    ESP_RETURN_ON_ERROR(esp_wifi_set_config(ESP_IF_WIFI_AP, &wifi_cfg), TAG, "Wi-Fi config failed");
+    s_ap_channel = wifi_cfg.ap.channel;
+#if CONFIG_NET_MANAGER_AP_INACTIVE_TIMEOUT_S > 0
+    esp_wifi_set_inactive_time(WIFI_IF_AP, CONFIG_NET_MANAGER_AP_INACTIVE_TIMEOUT_S);
+#endif
     ESP_LOGI(TAG, "Wi-Fi AP configured with SSID: %s", ap_config->ssid);
     return ESP_OK;
 }
@@ -291,12 +785,17 @@ static esp_err_t start_ap(const net_config_wifi_ap_t *ap_config)
 
 static esp_err_t start_eth(const net_config_ethernet_t *eth_config)
 {
-    // 1. Initialize all Ethernet drivers using the component.
-    ESP_ERROR_CHECK(ethernet_init_all(&s_eth_handles, &s_eth_handles_num));
+    esp_err_t ret = ESP_OK;
+    mem_sample_t mem;
+    mem_sample(&mem);
+
+    // 1. Install the Ethernet driver (ethernet_init) and tune its RX task.
+    ESP_GOTO_ON_ERROR(eth_driver_install(eth_config), err, TAG, "Ethernet driver init failed");
     if (s_eth_handles_num == 0)
     {
         ESP_LOGE(TAG, "ethernet_init_all() did not initialize any Ethernet interfaces.");
-        return ESP_FAIL;
+        ret = ESP_FAIL;
+        goto err;
     }
 
     ESP_LOGI(TAG, "%d Ethernet interface(s) initialized. Using the first one.", s_eth_handles_num);
@@ -311,18 +810,18 @@ static esp_err_t start_eth(const net_config_ethernet_t *eth_config)
     if (eth_config->use_static_ip)
     {
         ESP_LOGI(TAG, "Using static IP for Ethernet");
-        ESP_ERROR_CHECK(esp_netif_dhcpc_stop(s_netif_eth));
-        ESP_ERROR_CHECK(esp_netif_set_ip_info(s_netif_eth, &eth_config->ip_info));
+        ESP_GOTO_ON_ERROR(esp_netif_dhcpc_stop(s_netif_eth), err, TAG, "DHCP client stop failed");
+        ESP_GOTO_ON_ERROR(esp_netif_set_ip_info(s_netif_eth, &eth_config->ip_info), err, TAG, "Static IP failed");
 
         if (eth_config->dns1.addr != 0)
         {
             esp_netif_dns_info_t dns_info_1 = {.ip.u_addr.ip4 = eth_config->dns1};
-            ESP_ERROR_CHECK(esp_netif_set_dns_info(s_netif_eth, ESP_NETIF_DNS_MAIN, &dns_info_1));
+            ESP_GOTO_ON_ERROR(esp_netif_set_dns_info(s_netif_eth, ESP_NETIF_DNS_MAIN, &dns_info_1), err, TAG, "DNS server config failed");
         }
         if (eth_config->dns2.addr != 0)
         {
             esp_netif_dns_info_t dns_info_2 = {.ip.u_addr.ip4 = eth_config->dns2};
-            ESP_ERROR_CHECK(esp_netif_set_dns_info(s_netif_eth, ESP_NETIF_DNS_BACKUP, &dns_info_2));
+            ESP_GOTO_ON_ERROR(esp_netif_set_dns_info(s_netif_eth, ESP_NETIF_DNS_BACKUP, &dns_info_2), err, TAG, "DNS server config failed");
         }
     }
     else
@@ -332,13 +831,25 @@ static esp_err_t start_eth(const net_config_ethernet_t *eth_config)
 
     // 4. Attach the Ethernet driver to the TCP/IP stack.
     // Use esp_eth_new_netif_glue() as shown in the official example.
-    ESP_ERROR_CHECK(esp_netif_attach(s_netif_eth, esp_eth_new_netif_glue(s_eth_handles[0])));
+    s_eth_glue = esp_eth_new_netif_glue(s_eth_handles[0]);
+    ESP_GOTO_ON_FALSE(s_eth_glue, ESP_ERR_NO_MEM, err, TAG, "Ethernet netif glue failed");
+    ESP_GOTO_ON_ERROR(esp_netif_attach(s_netif_eth, s_eth_glue), err, TAG, "Ethernet netif attach failed");
+    esp_netif_tcpip_exec(traffic_hook_install, (void *)(intptr_t)NET_EVENT_SOURCE_ETHERNET);
+
+    // 5. Driver tuning. Pause ability is advertised during autonegotiation, so before the start.
+    eth_tune(eth_config);
 
-    // 5. Start the Ethernet driver.
-    ESP_ERROR_CHECK(esp_eth_start(s_eth_handles[0]));
+    // 6. Start the Ethernet driver.
+    ESP_GOTO_ON_ERROR(esp_eth_start(s_eth_handles[0]), err, TAG, "Ethernet start failed");
+    mem_phase_end(NET_MEM_PHASE_ETH, &mem);
 
     ESP_LOGI(TAG, "Ethernet started.");
     return ESP_OK;
+
+err:
+    mem_phase_end(NET_MEM_PHASE_ETH, &mem);
+    eth_release();
+    return ret;
 }
 
 /**
@@ -346,23 +857,91 @@ static esp_err_t start_eth(const net_config_ethernet_t *eth_config)
  */
 static void stop_all_interfaces(void)
 {
-    bool wifi_active = (s_netif_sta || s_netif_ap);
+    stop_eth();
+    stop_wifi();
+    dns_reset();
+#if CONFIG_NET_MANAGER_GW_PREWARM_ENABLED
+    timer_release(&s_gw_prewarm_timer);
+#endif
+
+    memset(&s_status, 0, sizeof(s_status));
+    s_status.sta_status = NET_STATUS_STOPPED;
+    s_status.ap_status = NET_STATUS_STOPPED;
+    s_status.eth_status = NET_STATUS_STOPPED;
+    ESP_LOGI(TAG, "All network interfaces stopped and cleaned up.");
+}
+
+/**
+ * @brief Drops the per-interface tracking (RTT, bound sockets, DNS, last address) of a
+ *        source that is about to go away.
+ */
+static void stop_source_tracking(net_event_source_t source)
+{
+    rtt_probe_stop(source);
+    gw_prewarm_cancel(source);
+    notify_bound_interface_lost(source);
+    s_rtt_ms[source] = 0;
+    s_last_ip4[source].addr = 0;
+    memset(&s_dns[source], 0, sizeof(s_dns[source]));
+    if (s_dns_primary_netif && s_dns_primary_netif == netif_from_source(source))
+        s_dns_primary_netif = NULL;
+}
 
+/**
+ * @brief Stops Ethernet and releases its driver and netif.
+ */
+static void stop_eth(void)
+{
+    stop_source_tracking(NET_EVENT_SOURCE_ETHERNET);
     if (s_netif_eth)
-    {
         ESP_LOGI(TAG, "Stopping Ethernet...");
-        // Destroying the netif created by ethernet_init will also
-        // handle stopping and de-initing the driver.
+    eth_release();
+
+    s_status.eth_status = NET_STATUS_STOPPED;
+    memset(&s_status.eth_ip_info, 0, sizeof(s_status.eth_ip_info));
+    memset(&s_status.eth_ip6_info, 0, sizeof(s_status.eth_ip6_info));
+}
+
+/**
+ * @brief Releases whatever start_eth() set up: the driver (stopped first), the netif glue,
+ *        the traffic hook and the netif. Safe on a partly started interface.
+ */
+static void eth_release(void)
+{
+    if (s_eth_handles_num > 0)
+        esp_eth_stop(s_eth_handles[0]); // Uninstall fails on a running driver
+    if (s_netif_eth)
+        esp_netif_tcpip_exec(traffic_hook_remove, (void *)(intptr_t)NET_EVENT_SOURCE_ETHERNET);
+    if (s_eth_glue)
+    {
+        esp_eth_del_netif_glue(s_eth_glue);
+        s_eth_glue = NULL;
+    }
+    if (s_netif_eth)
+    {
         esp_netif_destroy(s_netif_eth);
         s_netif_eth = NULL;
     }
+    eth_driver_uninstall();
+}
 
-    if (s_eth_handles)
-    {
-        ethernet_deinit_all(s_eth_handles);
-        s_eth_handles = NULL;
-        s_eth_handles_num = 0;
-    }
+/**
+ * @brief Stops Wi-Fi (STA and AP) and releases the driver, the netifs and the AP state.
+ */
+static void stop_wifi(void)
+{
+    bool wifi_active = (s_netif_sta || s_netif_ap);
+
+    stop_source_tracking(NET_EVENT_SOURCE_STA);
+    stop_source_tracking(NET_EVENT_SOURCE_AP);
+    timer_release(&s_ap_channel_timer);
+    timer_release(&s_ap_off_timer);
+    timer_release(&s_ap_on_timer);
+    timer_release(&s_ps_idle_timer);
+    atomic_store_explicit(&s_ps_low_power, false, memory_order_relaxed);
+    s_ap_auto_channel = false;
+    s_ap_declared = false;
+    ap_clients_clear();
 
     if (wifi_active)
     {
@@ -372,23 +951,25 @@ static void stop_all_interfaces(void)
         esp_wifi_deinit();
         if (s_netif_sta)
         {
+            esp_netif_tcpip_exec(traffic_hook_remove, (void *)(intptr_t)NET_EVENT_SOURCE_STA);
             esp_netif_destroy(s_netif_sta);
             s_netif_sta = NULL;
         }
         if (s_netif_ap)
         {
+            esp_netif_tcpip_exec(traffic_hook_remove, (void *)(intptr_t)NET_EVENT_SOURCE_AP);
             esp_netif_destroy(s_netif_ap);
             s_netif_ap = NULL;
         }
     }
 
-    memset(&s_status, 0, sizeof(s_status));
     s_status.sta_status = NET_STATUS_STOPPED;
+    memset(&s_status.sta_ip_info, 0, sizeof(s_status.sta_ip_info));
+    memset(&s_status.sta_ip6_info, 0, sizeof(s_status.sta_ip6_info));
     s_status.ap_status = NET_STATUS_STOPPED;
-    s_status.eth_status = NET_STATUS_STOPPED;
-
+    memset(&s_status.ap_ip_info, 0, sizeof(s_status.ap_ip_info));
+    s_status.ap_suspended = false;
     s_sta_retry_count = 0;
-    ESP_LOGI(TAG, "All network interfaces stopped and cleaned up.");
 }
 
 /**
@@ -408,268 +989,3683 @@ static void get_default_config_from_kconfig(net_manager_config_t *config)
     strncpy(config->wifi_ap_config.password, CONFIG_NET_MANAGER_WIFI_AP_PASSWORD_DEFAULT, sizeof(config->wifi_ap_config.password) - 1);
     config->wifi_ap_config.channel = CONFIG_NET_MANAGER_WIFI_AP_CHANNEL_DEFAULT;
     config->wifi_ap_config.max_connections = CONFIG_NET_MANAGER_WIFI_AP_MAX_CONN_DEFAULT;
+    config->wifi_ap_config.auto_off_delay_s = CONFIG_NET_MANAGER_WIFI_AP_AUTO_OFF_DELAY_S_DEFAULT;
+    config->wifi_ap_config.auto_on_delay_s = CONFIG_NET_MANAGER_WIFI_AP_AUTO_ON_DELAY_S_DEFAULT;
+    config->wifi_ap_config.auto_on_failed_retries = CONFIG_NET_MANAGER_WIFI_AP_AUTO_ON_FAILED_RETRIES_DEFAULT;
 #endif
 #ifdef CONFIG_NET_MANAGER_ETHERNET_ENABLED_DEFAULT
     config->ethernet_enabled = true;
 #endif
+#if CONFIG_NET_MANAGER_WIFI_BUFFERS_LOW_MEMORY
+    config->wifi_buffer_profile = NET_WIFI_BUFFERS_LOW_MEMORY;
+#elif CONFIG_NET_MANAGER_WIFI_BUFFERS_BALANCED
+    config->wifi_buffer_profile = NET_WIFI_BUFFERS_BALANCED;
+#elif CONFIG_NET_MANAGER_WIFI_BUFFERS_HIGH_THROUGHPUT
+    config->wifi_buffer_profile = NET_WIFI_BUFFERS_HIGH_THROUGHPUT;
+#endif
 }
 
-#if 0
 /**
- * @brief Helper to apply static IP configuration to a netif.
+ * @brief Maps an event source to the netif net_manager owns for it.
  */
-static void apply_static_ip_config(esp_netif_t *netif, const esp_netif_ip_info_t *ip_info, const esp_ip4_addr_t *dns1, const esp_ip4_addr_t *dns2)
+static esp_netif_t *netif_from_source(net_event_source_t source)
 {
-    // Stop the DHCP client first
-    ESP_ERROR_CHECK(esp_netif_dhcpc_stop(netif));
-
-    // Set static IP, netmask, gateway
-    ESP_ERROR_CHECK(esp_netif_set_ip_info(netif, ip_info));
-
-    // Set DNS servers
-    if (dns1 && dns1->addr != 0) {
-        esp_netif_dns_info_t dns_info_1 = {.ip.u_addr.ip4 = *dns1};
-        ESP_ERROR_CHECK(esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns_info_1));
-    }
-    if (dns2 && dns2->addr != 0) {
-        esp_netif_dns_info_t dns_info_2 = {.ip.u_addr.ip4 = *dns2};
-        ESP_ERROR_CHECK(esp_netif_set_dns_info(netif, ESP_NETIF_DNS_BACKUP, &dns_info_2));
+    switch (source)
+    {
+    case NET_EVENT_SOURCE_STA:
+        return s_netif_sta;
+    case NET_EVENT_SOURCE_AP:
+        return s_netif_ap;
+    case NET_EVENT_SOURCE_ETHERNET:
+        return s_netif_eth;
+    default:
+        return NULL;
     }
-    ESP_LOGI(TAG, "Applied static IP settings for netif %p", netif);
 }
-#endif
 
-/*
- * =====================================================================================
- * |                                                                                   |
- * |                                Public API Functions                               |
- * |                                                                                   |
- * =====================================================================================
+/**
+ * @brief Returns true if the interface is usable for outbound traffic.
  */
+static bool is_source_usable(net_event_source_t source)
+{
+    switch (source)
+    {
+    case NET_EVENT_SOURCE_STA:
+        return s_netif_sta && s_status.sta_status == NET_STATUS_CONNECTED;
+    case NET_EVENT_SOURCE_AP:
+        return s_netif_ap && s_status.ap_status != NET_STATUS_STOPPED && s_status.ap_status != NET_STATUS_UNINITIALIZED;
+    case NET_EVENT_SOURCE_ETHERNET:
+        return s_netif_eth && s_status.eth_status == NET_STATUS_CONNECTED;
+    default:
+        return false;
+    }
+}
 
-esp_err_t net_manager_init(net_event_callback_t cb)
+/**
+ * @brief Resolves a binding policy to an interface. Must be called with the lock held.
+ */
+static esp_err_t resolve_bind_policy(const net_bind_policy_t *policy, net_event_source_t *source)
 {
-    if (s_is_initialized)
+    // Preference order when nothing better is known: Ethernet first, then STA.
+    static const net_event_source_t fallback_order[] = {NET_EVENT_SOURCE_ETHERNET, NET_EVENT_SOURCE_STA};
+
+    switch (policy->type)
     {
-        ESP_LOGW(TAG, "Already initialized");
+    case NET_BIND_POLICY_SPECIFIC_SOURCE:
+        if (!is_source_usable(policy->source))
+            return ESP_ERR_NOT_FOUND;
+        *source = policy->source;
         return ESP_OK;
-    }
 
-    s_component_mutex = xSemaphoreCreateMutex();
-    if (!s_component_mutex)
+    case NET_BIND_POLICY_LOWEST_RTT:
     {
-        ESP_LOGE(TAG, "Failed to create mutex");
-        return ESP_FAIL;
+        uint32_t best_rtt = UINT32_MAX;
+        bool found = false;
+        for (size_t i = 0; i < sizeof(fallback_order) / sizeof(fallback_order[0]); i++)
+        {
+            net_event_source_t candidate = fallback_order[i];
+            if (is_source_usable(candidate) && s_rtt_ms[candidate] != 0 && s_rtt_ms[candidate] < best_rtt)
+            {
+                best_rtt = s_rtt_ms[candidate];
+                *source = candidate;
+                found = true;
+            }
+        }
+        if (found)
+            return ESP_OK;
+        // No RTT samples yet, behave like PRIMARY.
+    }
+    // fall through
+    case NET_BIND_POLICY_PRIMARY:
+    {
+        esp_netif_t *default_netif = esp_netif_get_default_netif();
+        for (int i = 0; i < NET_SOURCE_COUNT; i++)
+        {
+            if (default_netif && netif_from_source((net_event_source_t)i) == default_netif && is_source_usable((net_event_source_t)i))
+            {
+                *source = (net_event_source_t)i;
+                return ESP_OK;
+            }
+        }
+        for (size_t i = 0; i < sizeof(fallback_order) / sizeof(fallback_order[0]); i++)
+        {
+            if (is_source_usable(fallback_order[i]))
+            {
+                *source = fallback_order[i];
+                return ESP_OK;
+            }
+        }
+        return ESP_ERR_NOT_FOUND;
     }
 
-    LOCK();
-    memset(&s_status, 0, sizeof(net_manager_status_t));
-    s_user_callback = cb;
-
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &event_handler, NULL, NULL));
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, ESP_EVENT_ANY_ID, &event_handler, NULL, NULL));
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(ETH_EVENT, ESP_EVENT_ANY_ID, &event_handler, NULL, NULL));
+    default:
+        return ESP_ERR_INVALID_ARG;
+    }
+}
 
-    s_is_initialized = true;
-    UNLOCK();
+/**
+ * @brief Dispatches NET_STATUS_BOUND_INTERFACE_LOST for every socket bound to a source
+ *        and forgets them. Must be called with the lock held.
+ */
+static void notify_bound_interface_lost(net_event_source_t source)
+{
+    for (int i = 0; i < CONFIG_NET_MANAGER_MAX_BOUND_SOCKETS; i++)
+    {
+        if (!s_bound_sockets[i].in_use || s_bound_sockets[i].source != source)
+            continue;
 
-    ESP_LOGI(TAG, "Initialized successfully");
-    return ESP_OK;
+        int fd = s_bound_sockets[i].fd;
+        s_bound_sockets[i].in_use = false;
+        ESP_LOGW(TAG, "Interface %d lost, socket %d is no longer routable", source, fd);
+        if (s_user_callback)
+        {
+            // data is only valid during the callback, as documented in net_manager_bind_socket().
+            net_manager_event_t event = {.source = source, .status = NET_STATUS_BOUND_INTERFACE_LOST, .data = &fd};
+            s_user_callback(&event);
+        }
+    }
 }
 
-esp_err_t net_manager_deinit(void)
+/**
+ * @brief Feeds an RTT sample into the EWMA of an interface.
+ *        Must be called with the lock held.
+ */
+static void rtt_update(net_event_source_t source, uint32_t rtt_ms)
 {
-    if (!s_is_initialized)
-        return ESP_OK;
+    if (s_rtt_ms[source] == 0)
+        s_rtt_ms[source] = rtt_ms;
+    else
+        s_rtt_ms[source] = (s_rtt_ms[source] * (RTT_EWMA_WEIGHT - 1) + rtt_ms + RTT_EWMA_WEIGHT / 2) / RTT_EWMA_WEIGHT;
+}
 
-    LOCK();
-    stop_all_interfaces();
-    esp_event_handler_instance_unregister(WIFI_EVENT, ESP_EVENT_ANY_ID, &event_handler);
-    esp_event_handler_instance_unregister(IP_EVENT, ESP_EVENT_ANY_ID, &event_handler);
-    esp_event_handler_instance_unregister(ETH_EVENT, ESP_EVENT_ANY_ID, &event_handler);
-    s_is_initialized = false;
+#if CONFIG_NET_MANAGER_RTT_PROBE_ENABLED
+/**
+ * @brief Ping success callback, feeds the measured RTT into the EWMA.
+ *        rtt_probe_stop() stops and deletes the session with the lock held, so the ping
+ *        task must not wait for it: a sample that finds the lock taken is dropped, and
+ *        one from a session that is being deleted is ignored.
+ */
+static void rtt_probe_on_success(esp_ping_handle_t hdl, void *args)
+{
+    net_event_source_t source = (net_event_source_t)(intptr_t)args;
+    uint32_t elapsed_ms = 0;
+    esp_ping_get_profile(hdl, ESP_PING_PROF_TIMEGAP, &elapsed_ms, sizeof(elapsed_ms));
+    if (xSemaphoreTake(s_component_mutex, 0) != pdPASS)
+        return;
+    if (s_rtt_probe[source] == hdl)
+        rtt_update(source, elapsed_ms ? elapsed_ms : 1);
     UNLOCK();
-
-    vSemaphoreDelete(s_component_mutex);
-    s_component_mutex = NULL;
-    ESP_LOGI(TAG, "De-initialized successfully");
-    return ESP_OK;
 }
+#endif
 
-esp_err_t net_manager_start(const net_manager_config_t *config)
+/**
+ * @brief Starts a periodic gateway ping on an interface to measure its RTT.
+ */
+static void rtt_probe_start(net_event_source_t source, const esp_netif_ip_info_t *ip_info)
 {
-    assert(s_is_initialized);
-    LOCK();
+#if CONFIG_NET_MANAGER_RTT_PROBE_ENABLED
+    rtt_probe_stop(source);
+    if (ip_info->gw.addr == 0)
+        return;
 
-    stop_all_interfaces(); // Ensure a clean state before starting
+    esp_ping_config_t ping_cfg = ESP_PING_DEFAULT_CONFIG();
+    ping_cfg.target_addr.type = IPADDR_TYPE_V4;
+    ping_cfg.target_addr.u_addr.ip4.addr = ip_info->gw.addr;
+    ping_cfg.count = ESP_PING_COUNT_INFINITE;
+    ping_cfg.interval_ms = CONFIG_NET_MANAGER_RTT_PROBE_INTERVAL_MS;
+    ping_cfg.interface = esp_netif_get_netif_impl_index(netif_from_source(source));
 
-    net_manager_config_t cfg;
-    if (config)
+    esp_ping_callbacks_t cbs = {
+        .on_ping_success = rtt_probe_on_success,
+        .cb_args = (void *)(intptr_t)source,
+    };
+    if (esp_ping_new_session(&ping_cfg, &cbs, &s_rtt_probe[source]) == ESP_OK)
     {
-        memcpy(&cfg, config, sizeof(net_manager_config_t));
+        esp_ping_start(s_rtt_probe[source]);
     }
     else
     {
-        if (net_manager_load_config_from_nvs(&cfg) != ESP_OK)
-        {
-            ESP_LOGI(TAG, "No config in NVS, using Kconfig defaults.");
-            get_default_config_from_kconfig(&cfg);
-        }
+        ESP_LOGW(TAG, "Failed to start RTT probe on interface %d", source);
+        s_rtt_probe[source] = NULL;
     }
+#else
+    (void)source;
+    (void)ip_info;
+#endif
+}
 
-    bool is_wifi_needed = cfg.wifi_sta_enabled || cfg.wifi_ap_enabled;
-    if (is_wifi_needed)
-    {
-        wifi_init_config_t wifi_init_cfg = WIFI_INIT_CONFIG_DEFAULT();
-        ESP_ERROR_CHECK(esp_wifi_init(&wifi_init_cfg));
+/**
+ * @brief Stops the RTT probe of an interface and forgets its RTT estimate.
+ */
+static void rtt_probe_stop(net_event_source_t source)
+{
+#if CONFIG_NET_MANAGER_RTT_PROBE_ENABLED
+    if (s_rtt_probe[source])
+    {
+        esp_ping_stop(s_rtt_probe[source]);
+        esp_ping_delete_session(s_rtt_probe[source]);
+        s_rtt_probe[source] = NULL;
+    }
+#endif
+    s_rtt_ms[source] = 0;
+}
+
+#if CONFIG_NET_MANAGER_GW_PREWARM_ENABLED
+typedef struct {
+    esp_netif_t *netif;
+    bool gateway_resolved;
+} gw_prewarm_ctx_t;
+
+/**
+ * @brief Sends a gratuitous ARP and an ARP request for the gateway. Runs in the TCP/IP task.
+ */
+static esp_err_t gw_prewarm_announce(void *ctx)
+{
+    gw_prewarm_ctx_t *prewarm = (gw_prewarm_ctx_t *)ctx;
+    struct netif *lwip_netif = esp_netif_get_netif_impl(prewarm->netif);
+    if (!lwip_netif || !netif_is_up(lwip_netif) || ip4_addr_isany(netif_ip4_addr(lwip_netif)))
+        return ESP_ERR_INVALID_STATE;
+
+    etharp_gratuitous(lwip_netif);
+    if (!ip4_addr_isany(netif_ip4_gw(lwip_netif)))
+        etharp_request(lwip_netif, netif_ip4_gw(lwip_netif));
+    return ESP_OK;
+}
+
+/**
+ * @brief Checks whether the gateway MAC is in the ARP cache. Runs in the TCP/IP task.
+ */
+static esp_err_t gw_prewarm_check(void *ctx)
+{
+    gw_prewarm_ctx_t *prewarm = (gw_prewarm_ctx_t *)ctx;
+    struct netif *lwip_netif = esp_netif_get_netif_impl(prewarm->netif);
+    struct eth_addr *eth_ret = NULL;
+    const ip4_addr_t *ip_ret = NULL;
+
+    prewarm->gateway_resolved = lwip_netif && !ip4_addr_isany(netif_ip4_gw(lwip_netif)) &&
+                                etharp_find_addr(lwip_netif, netif_ip4_gw(lwip_netif), &eth_ret, &ip_ret) >= 0;
+    return ESP_OK;
+}
+
+/**
+ * @brief Gateway poll timer expiry, deferred to the worker (the check runs in the TCP/IP task).
+ */
+static void gw_prewarm_timer_cb(TimerHandle_t timer)
+{
+    post_work(NET_WORK_GW_PREWARM);
+}
+#endif
+
+/**
+ * @brief Announces our IP/MAC with a gratuitous ARP and asks for the gateway MAC, so the
+ *        first application packet does not pay an ARP round trip and upstream switches
+ *        relearn our port. Does not wait for the reply.
+ * @return true if the probes were sent.
+ */
+static bool gateway_prewarm(esp_netif_t *netif)
+{
+#if CONFIG_NET_MANAGER_GW_PREWARM_ENABLED
+    if (!netif)
+        return false;
+    gw_prewarm_ctx_t prewarm = {.netif = netif};
+    return esp_netif_tcpip_exec(gw_prewarm_announce, &prewarm) == ESP_OK;
+#else
+    (void)netif;
+    return false;
+#endif
+}
+
+/**
+ * @brief Announces an interface that got an address and holds back its CONNECTED (or
+ *        ADDRESS_CHANGED) event until the gateway is resolved or the prewarm timeout
+ *        passes; gw_prewarm_poll() completes it from the worker. Must be called with the
+ *        lock held.
+ * @return true if the event is deferred, false if it is to be dispatched now.
+ */
+static bool gw_prewarm_defer(net_event_source_t source, bool address_changed)
+{
+#if CONFIG_NET_MANAGER_GW_PREWARM_ENABLED
+    if (!gateway_prewarm(netif_from_source(source)) || CONFIG_NET_MANAGER_GW_PREWARM_TIMEOUT_MS == 0)
+        return false;
+    if (!s_gw_prewarm_timer)
+        s_gw_prewarm_timer = timer_create(NM_TIMER_GW_PREWARM, "nm_gw", pdMS_TO_TICKS(GW_PREWARM_POLL_MS), pdTRUE, NULL,
+                                          gw_prewarm_timer_cb);
+    if (!s_gw_prewarm_timer || xTimerStart(s_gw_prewarm_timer, 0) != pdPASS)
+        return false;
+
+    s_gw_wait[source] = (gw_prewarm_wait_t){
+        .pending = true,
+        .address_changed = address_changed,
+        .start_us = esp_timer_get_time(),
+    };
+    return true;
+#else
+    (void)source;
+    (void)address_changed;
+    return false;
+#endif
+}
+
+/**
+ * @brief Drops a deferred CONNECTED event of an interface that went down meanwhile.
+ */
+static void gw_prewarm_cancel(net_event_source_t source)
+{
+#if CONFIG_NET_MANAGER_GW_PREWARM_ENABLED
+    s_gw_wait[source].pending = false;
+#else
+    (void)source;
+#endif
+}
+
+/**
+ * @brief Worker: dispatches the deferred events whose gateway is resolved or whose wait
+ *        timed out, and stops polling once none is left. Must be called with the lock held.
+ */
+static void gw_prewarm_poll(void)
+{
+#if CONFIG_NET_MANAGER_GW_PREWARM_ENABLED
+    bool waiting = false;
+    for (int i = 0; i < NET_SOURCE_COUNT; i++)
+    {
+        gw_prewarm_wait_t *wait = &s_gw_wait[i];
+        if (!wait->pending)
+            continue;
+
+        gw_prewarm_ctx_t prewarm = {.netif = netif_from_source((net_event_source_t)i)};
+        esp_netif_tcpip_exec(gw_prewarm_check, &prewarm);
+        uint32_t elapsed_ms = (uint32_t)((esp_timer_get_time() - wait->start_us) / 1000);
+        if (!prewarm.gateway_resolved && elapsed_ms < CONFIG_NET_MANAGER_GW_PREWARM_TIMEOUT_MS)
+        {
+            waiting = true;
+            continue;
+        }
+        if (prewarm.gateway_resolved)
+            ESP_LOGD(TAG, "Gateway resolved in %lu ms", (unsigned long)elapsed_ms);
+        else
+            ESP_LOGW(TAG, "Gateway not resolved within %d ms", CONFIG_NET_MANAGER_GW_PREWARM_TIMEOUT_MS);
+
+        wait->pending = false;
+        iface_state_t iface;
+        if (!iface_from_netif(prewarm.netif, &iface))
+            continue;
+        // An IPv6 address may have made the interface CONNECTED during the wait.
+        net_manager_event_t event;
+        iface_connected(&iface, *iface.status == NET_STATUS_CONNECTED, wait->address_changed, &event);
+        dispatch_event(&event);
+    }
+    if (!waiting)
+        timer_release(&s_gw_prewarm_timer);
+#endif
+}
+
+/**
+ * @brief After an interface is lost, re-announces the interfaces that carry the traffic now.
+ */
+static void reannounce_after_failover(net_event_source_t lost_source)
+{
+    if (lost_source != NET_EVENT_SOURCE_STA && s_status.sta_status == NET_STATUS_CONNECTED)
+        gateway_prewarm(s_netif_sta);
+    if (lost_source != NET_EVENT_SOURCE_ETHERNET && s_status.eth_status == NET_STATUS_CONNECTED)
+        gateway_prewarm(s_netif_eth);
+}
+
+/**
+ * @brief Reads the DNS servers the interface received (DHCP) or was configured with (static)
+ *        and starts ranking them. The same set keeps its ranking. Must be called with the
+ *        lock held.
+ */
+static void dns_capture_servers(net_event_source_t source)
+{
+    esp_netif_t *netif = netif_from_source(source);
+    dns_state_t *dns = &s_dns[source];
+    esp_netif_dns_info_t main_dns = {0}, backup_dns = {0};
+
+    esp_netif_get_dns_info(netif, ESP_NETIF_DNS_MAIN, &main_dns);
+    esp_netif_get_dns_info(netif, ESP_NETIF_DNS_BACKUP, &backup_dns);
+
+    // Keep the statistics if the server set is unchanged (e.g. DHCP renewal).
+    if (dns->servers[0].addr.addr == main_dns.ip.u_addr.ip4.addr && dns->servers[1].addr.addr == backup_dns.ip.u_addr.ip4.addr)
+        return;
+    if (dns->servers[0].addr.addr == backup_dns.ip.u_addr.ip4.addr && dns->servers[1].addr.addr == main_dns.ip.u_addr.ip4.addr)
+    {
+        // The renewal set the servers in the received order over a swap, restore it.
+        dns_apply_servers(source);
+        return;
+    }
+
+    memset(dns, 0, sizeof(*dns));
+    dns->servers[0].addr = main_dns.ip.u_addr.ip4;
+    dns->servers[1].addr = backup_dns.ip.u_addr.ip4;
+}
+
+/**
+ * @brief Applies the ranked DNS set of an interface to its netif. Must be called with the lock held.
+ */
+static void dns_apply_servers(net_event_source_t source)
+{
+    esp_netif_t *netif = netif_from_source(source);
+    const dns_state_t *dns = &s_dns[source];
+    if (!netif || dns->servers[0].addr.addr == 0)
+        return;
+
+    esp_netif_dns_info_t main_dns = {.ip.u_addr.ip4 = dns->servers[0].addr, .ip.type = ESP_IPADDR_TYPE_V4};
+    esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &main_dns);
+    if (dns->servers[1].addr.addr != 0)
+    {
+        esp_netif_dns_info_t backup_dns = {.ip.u_addr.ip4 = dns->servers[1].addr, .ip.type = ESP_IPADDR_TYPE_V4};
+        esp_netif_set_dns_info(netif, ESP_NETIF_DNS_BACKUP, &backup_dns);
+    }
+}
+
+/**
+ * @brief Returns the source of the interface holding the default route, or -1.
+ */
+static int dns_primary_source(void)
+{
+    esp_netif_t *default_netif = esp_netif_get_default_netif();
+    for (int i = 0; i < NET_SOURCE_COUNT; i++)
+    {
+        if (default_netif && netif_from_source((net_event_source_t)i) == default_netif)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Re-applies the DNS set of the primary interface when the default route moved to
+ *        another interface, and drops cached answers obtained through the old one.
+ *        Must be called with the lock held.
+ */
+static void dns_check_primary_change(void)
+{
+    esp_netif_t *default_netif = esp_netif_get_default_netif();
+    if (default_netif == s_dns_primary_netif)
+        return;
+
+    s_dns_primary_netif = default_netif;
+    int source = dns_primary_source();
+    if (source < 0)
+        return;
+
+    ESP_LOGI(TAG, "Primary interface changed to %d, re-applying its DNS servers", source);
+    dns_apply_servers((net_event_source_t)source);
+    memset(s_dns_cache, 0, sizeof(s_dns_cache));
+}
+
+/**
+ * @brief Records a lookup against the server lwIP got it from, and swaps main and backup
+ *        once the main server has degraded. Nothing is recorded if the primary interface
+ *        or its main server changed while the lookup ran. Must be called with the lock held.
+ * @param main_addr Main server when the lookup started.
+ * @param elapsed_ms Lookup time.
+ * @param answered false if no server answered (the lookup timed out).
+ */
+static void dns_record_lookup(esp_ip4_addr_t main_addr, uint32_t elapsed_ms, bool answered)
+{
+    int source = dns_primary_source();
+    if (source < 0)
+        return;
+
+    dns_state_t *dns = &s_dns[source];
+    net_dns_server_stats_t *main_server = &dns->servers[0];
+    net_dns_server_stats_t *backup_server = &dns->servers[1];
+    if (main_server->addr.addr == 0 || main_server->addr.addr != main_addr.addr)
+        return;
+
+    main_server->lookups++;
+    if (elapsed_ms < DNS_SERVER_SWITCH_MS)
+    {
+        // The main server answered, possibly to a resend.
+        if (elapsed_ms < CONFIG_NET_MANAGER_DNS_SLOW_MS)
+        {
+            main_server->avg_latency_ms = main_server->avg_latency_ms ? (main_server->avg_latency_ms * 7 + elapsed_ms) / 8 : elapsed_ms;
+            dns->consecutive_bad = 0;
+            return;
+        }
+    }
+    else
+    {
+        // The main server never answered; the backup (if any) was asked next.
+        main_server->failures++;
+        if (backup_server->addr.addr != 0)
+        {
+            uint32_t backup_ms = elapsed_ms - DNS_SERVER_WINDOW_MS;
+            if (elapsed_ms < DNS_SERVER_WINDOW_MS)
+                backup_ms = 0;
+            backup_server->lookups++;
+            if (answered)
+                backup_server->avg_latency_ms = backup_server->avg_latency_ms ? (backup_server->avg_latency_ms * 7 + backup_ms) / 8 : backup_ms;
+            else
+                backup_server->failures++;
+        }
+    }
+
+    if (++dns->consecutive_bad < CONFIG_NET_MANAGER_DNS_DEGRADE_THRESHOLD || backup_server->addr.addr == 0)
+        return;
+
+    ESP_LOGW(TAG, "DNS server " IPSTR " degraded, promoting " IPSTR, IP2STR(&dns->servers[0].addr), IP2STR(&dns->servers[1].addr));
+    net_dns_server_stats_t demoted = dns->servers[0];
+    dns->servers[0] = dns->servers[1];
+    dns->servers[1] = demoted;
+    dns->consecutive_bad = 0;
+    dns_apply_servers((net_event_source_t)source);
+}
+
+/**
+ * @brief Looks up a host name in the DNS cache. Must be called with the lock held.
+ */
+static dns_cache_entry_t *dns_cache_find(const char *hostname)
+{
+    TickType_t now = xTaskGetTickCount();
+    for (int i = 0; i < CONFIG_NET_MANAGER_DNS_CACHE_SIZE; i++)
+    {
+        dns_cache_entry_t *entry = &s_dns_cache[i];
+        if (!entry->in_use)
+            continue;
+        if ((int32_t)(entry->expires - now) <= 0)
+        {
+            entry->in_use = false;
+            continue;
+        }
+        if (strcmp(entry->hostname, hostname) == 0)
+            return entry;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Stores an answer in the DNS cache, evicting the entry closest to expiry if full.
+ *        Must be called with the lock held.
+ */
+static void dns_cache_store(const char *hostname, const esp_ip4_addr_t *addr, bool negative)
+{
+    if (strlen(hostname) >= CONFIG_NET_MANAGER_DNS_CACHE_NAME_LEN)
+        return;
+
+    TickType_t now = xTaskGetTickCount();
+    dns_cache_entry_t *slot = dns_cache_find(hostname);
+    for (int i = 0; !slot && i < CONFIG_NET_MANAGER_DNS_CACHE_SIZE; i++)
+    {
+        if (!s_dns_cache[i].in_use)
+            slot = &s_dns_cache[i];
+    }
+    if (!slot)
+    {
+        slot = &s_dns_cache[0];
+        for (int i = 1; i < CONFIG_NET_MANAGER_DNS_CACHE_SIZE; i++)
+        {
+            if ((int32_t)(s_dns_cache[i].expires - slot->expires) < 0)
+                slot = &s_dns_cache[i];
+        }
+    }
+
+    strcpy(slot->hostname, hostname);
+    slot->addr.addr = negative ? 0 : addr->addr;
+    slot->negative = negative;
+    slot->expires = now + pdMS_TO_TICKS((negative ? CONFIG_NET_MANAGER_DNS_NEGATIVE_TTL_S : CONFIG_NET_MANAGER_DNS_POSITIVE_TTL_S) * 1000);
+    slot->in_use = true;
+}
+
+/**
+ * @brief Forgets all DNS rankings and cached answers. Must be called with the lock held.
+ */
+static void dns_reset(void)
+{
+    memset(s_dns, 0, sizeof(s_dns));
+    memset(s_dns_cache, 0, sizeof(s_dns_cache));
+    s_dns_primary_netif = NULL;
+}
+
+/**
+ * @brief Resolves an STA/ETH netif to its slots in s_status.
+ * @return false if the netif is not an STA/ETH interface owned by net_manager.
+ */
+static bool iface_from_netif(esp_netif_t *netif, iface_state_t *iface)
+{
+    if (netif && netif == s_netif_sta)
+    {
+        *iface = (iface_state_t){NET_EVENT_SOURCE_STA, &s_status.sta_status, &s_status.sta_ip_info, &s_status.sta_ip6_info};
+        return true;
+    }
+    if (netif && netif == s_netif_eth)
+    {
+        *iface = (iface_state_t){NET_EVENT_SOURCE_ETHERNET, &s_status.eth_status, &s_status.eth_ip_info, &s_status.eth_ip6_info};
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Handles IP_EVENT_STA_GOT_IP / IP_EVENT_ETH_GOT_IP. Must be called with the lock held.
+ *        Coming up dispatches CONNECTED; a lease renewal that moved the address, or a first
+ *        lease on an interface already connected over IPv6, dispatches ADDRESS_CHANGED; a
+ *        renewal with the same address dispatches nothing.
+ * @return true if event_to_dispatch was filled.
+ */
+static bool handle_got_ip(const ip_event_got_ip_t *event, net_manager_event_t *event_to_dispatch)
+{
+    iface_state_t iface;
+    if (!iface_from_netif(event->esp_netif, &iface))
+        return false;
+
+    net_event_source_t source = iface.source;
+    bool had_address = s_last_ip4[source].addr != 0;
+    bool address_changed = had_address && (event->ip_changed || s_last_ip4[source].addr != event->ip_info.ip.addr);
+    bool was_connected = (*iface.status == NET_STATUS_CONNECTED);
+    bool had_ip4 = iface.ip_info->ip.addr != 0;
+
+    memcpy(iface.ip_info, &event->ip_info, sizeof(esp_netif_ip_info_t));
+    s_last_ip4[source] = event->ip_info.ip;
+    dns_capture_servers(source);
+
+    if (was_connected && had_ip4 && !address_changed)
+    {
+        ESP_LOGD(TAG, "Interface %d lease renewed, address unchanged", source);
+        return false;
+    }
+
+    ESP_LOGI(TAG, "%s Got IP: " IPSTR "%s", (source == NET_EVENT_SOURCE_STA) ? "STA" : "ETH", IP2STR(&event->ip_info.ip),
+             address_changed ? " (address changed)" : "");
+    if (source == NET_EVENT_SOURCE_STA)
+        s_sta_retry_count = 0;
+    rtt_probe_start(source, &event->ip_info);
+
+    if (gw_prewarm_defer(source, address_changed))
+        return false;
+    iface_connected(&iface, was_connected, address_changed, event_to_dispatch);
+    return true;
+}
+
+/**
+ * @brief Completes the transition of an interface that got an address: ADDRESS_CHANGED if
+ *        it was already connected, else CONNECTED (preceded by ADDRESS_CHANGED if the new
+ *        lease moved the address). Must be called with the lock held.
+ */
+static void iface_connected(const iface_state_t *iface, bool was_connected, bool address_changed,
+                            net_manager_event_t *event_to_dispatch)
+{
+    if (was_connected)
+    {
+        *event_to_dispatch = (net_manager_event_t){.source = iface->source, .status = NET_STATUS_ADDRESS_CHANGED, .data = iface->ip_info};
+        return;
+    }
+
+    *iface->status = NET_STATUS_CONNECTED;
+    if (address_changed && s_user_callback)
+    {
+        net_manager_event_t changed_event = {.source = iface->source, .status = NET_STATUS_ADDRESS_CHANGED, .data = iface->ip_info};
+        s_user_callback(&changed_event);
+    }
+    *event_to_dispatch = (net_manager_event_t){.source = iface->source, .status = NET_STATUS_CONNECTED, .data = iface->ip_info};
+}
+
+/**
+ * @brief Handles IP_EVENT_STA_LOST_IP / IP_EVENT_ETH_LOST_IP. Must be called with the lock held.
+ *        The interface stays CONNECTED if it still has a routable IPv6 address; IP_LOST is
+ *        then not dispatched, since the status did not change.
+ * @return true if event_to_dispatch was filled.
+ */
+static bool handle_lost_ip(const ip_event_got_ip_t *event, net_manager_event_t *event_to_dispatch)
+{
+    iface_state_t iface;
+    if (!iface_from_netif(event->esp_netif, &iface))
+        return false;
+
+    net_event_source_t source = iface.source;
+    ESP_LOGW(TAG, "%s Lost IP", (source == NET_EVENT_SOURCE_STA) ? "STA" : "ETH");
+    memset(iface.ip_info, 0, sizeof(esp_netif_ip_info_t));
+    rtt_probe_stop(source);
+    gw_prewarm_cancel(source);
+
+    if (ip6_refresh_info(event->esp_netif, iface.ip6_info))
+    {
+        ESP_LOGI(TAG, "Interface %d stays connected over IPv6", source);
+        dns_check_primary_change();
+        return false;
+    }
+
+    *iface.status = NET_STATUS_IP_LOST;
+    notify_bound_interface_lost(source);
+    reannounce_after_failover(source);
+    *event_to_dispatch = (net_manager_event_t){.source = source, .status = NET_STATUS_IP_LOST};
+    return true;
+}
+
+/**
+ * @brief Home slot of a MAC in the AP client table (FNV-1a).
+ */
+static size_t ap_client_hash(const uint8_t mac[6])
+{
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < 6; i++)
+    {
+        hash ^= mac[i];
+        hash *= 16777619u;
+    }
+    return hash % CONFIG_NET_MANAGER_AP_CLIENT_TABLE_SIZE;
+}
+
+/**
+ * @brief Finds the slot holding a MAC, or -1.
+ */
+static int ap_client_find(const uint8_t mac[6])
+{
+    size_t idx = ap_client_hash(mac);
+    for (int probe = 0; probe < CONFIG_NET_MANAGER_AP_CLIENT_TABLE_SIZE; probe++)
+    {
+        const ap_client_slot_t *slot = &s_ap_clients[idx];
+        if (!slot->in_use)
+            return -1;
+        if (memcmp(slot->client.mac, mac, 6) == 0)
+            return (int)idx;
+        idx = (idx + 1) % CONFIG_NET_MANAGER_AP_CLIENT_TABLE_SIZE;
+    }
+    return -1;
+}
+
+/**
+ * @brief Opens a write section on the AP client table. Readers retry while it is open.
+ */
+static inline void ap_clients_write_begin(void)
+{
+    atomic_fetch_add_explicit(&s_ap_clients_seq, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+/**
+ * @brief Closes a write section on the AP client table and refreshes the client count.
+ */
+static inline void ap_clients_write_end(void)
+{
+    uint8_t count = 0;
+    for (int i = 0; i < CONFIG_NET_MANAGER_AP_CLIENT_TABLE_SIZE; i++)
+        count += s_ap_clients[i].in_use ? 1 : 0;
+    s_status.ap_connected_clients = count;
+
+    atomic_fetch_add_explicit(&s_ap_clients_seq, 1, memory_order_release);
+}
+
+/**
+ * @brief Adds (or refreshes, on re-association) a client. Must be called with the lock held.
+ */
+static void ap_client_join(const wifi_event_ap_staconnected_t *event)
+{
+    int8_t rssi = 0;
+    wifi_sta_list_t sta_list;
+    if (esp_wifi_ap_get_sta_list(&sta_list) == ESP_OK)
+    {
+        for (int i = 0; i < sta_list.num; i++)
+        {
+            if (memcmp(sta_list.sta[i].mac, event->mac, 6) == 0)
+                rssi = sta_list.sta[i].rssi;
+        }
+    }
+
+    int found = ap_client_find(event->mac);
+    size_t idx = (found >= 0) ? (size_t)found : ap_client_hash(event->mac);
+    if (found < 0)
+    {
+        int probe = 0;
+        while (s_ap_clients[idx].in_use && probe++ < CONFIG_NET_MANAGER_AP_CLIENT_TABLE_SIZE)
+            idx = (idx + 1) % CONFIG_NET_MANAGER_AP_CLIENT_TABLE_SIZE;
+        if (s_ap_clients[idx].in_use)
+        {
+            ESP_LOGW(TAG, "AP client table full, " MACSTR " not tracked", MAC2STR(event->mac));
+            return;
+        }
+    }
+
+    // A re-association keeps its stats slot; a new client takes the first free one.
+    uint8_t stats_idx = 0;
+    if (found >= 0)
+    {
+        stats_idx = s_ap_clients[idx].stats_idx;
+    }
+    else
+    {
+        bool used[CONFIG_NET_MANAGER_AP_CLIENT_TABLE_SIZE] = {0};
+        for (int i = 0; i < CONFIG_NET_MANAGER_AP_CLIENT_TABLE_SIZE; i++)
+        {
+            if (s_ap_clients[i].in_use)
+                used[s_ap_clients[i].stats_idx] = true;
+        }
+        while (used[stats_idx])
+            stats_idx++;
+    }
+    for (int dir = 0; dir < TRAFFIC_DIRS; dir++)
+    {
+        ap_client_counter_t *counter = &s_ap_client_traffic[stats_idx][dir];
+        unsigned seq = atomic_load_explicit(&counter->seq, memory_order_relaxed);
+        atomic_store_explicit(&counter->seq, seq + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        counter->bytes = 0;
+        counter->last_us = 0;
+        atomic_store_explicit(&counter->seq, seq + 2, memory_order_release);
+    }
+
+    ap_clients_write_begin();
+    ap_client_slot_t *slot = &s_ap_clients[idx];
+    memset(slot, 0, sizeof(*slot));
+    slot->stats_idx = stats_idx;
+    memcpy(slot->client.mac, event->mac, 6);
+    slot->client.aid = event->aid;
+    slot->client.rssi = rssi;
+    slot->client.join_time_us = esp_timer_get_time();
+    slot->client.last_active_us = slot->client.join_time_us;
+    slot->in_use = true;
+    ap_clients_write_end();
+}
+
+/**
+ * @brief Removes a client with backward-shift deletion, so lookups never need tombstones.
+ *        Must be called with the lock held. Unknown MACs are ignored (no counter underflow).
+ * @return true if the client was in the table.
+ */
+static bool ap_client_leave(const uint8_t mac[6])
+{
+    int found = ap_client_find(mac);
+    if (found < 0)
+        return false;
+
+    ap_clients_write_begin();
+    size_t hole = (size_t)found;
+    size_t next = hole;
+    while (true)
+    {
+        next = (next + 1) % CONFIG_NET_MANAGER_AP_CLIENT_TABLE_SIZE;
+        if (!s_ap_clients[next].in_use)
+            break;
+        size_t home = ap_client_hash(s_ap_clients[next].client.mac);
+        // Move the entry back if its home slot is not cyclically in (hole, next].
+        bool home_in_range = (hole < next) ? (home > hole && home <= next) : (home > hole || home <= next);
+        if (!home_in_range)
+        {
+            s_ap_clients[hole] = s_ap_clients[next];
+            hole = next;
+        }
+    }
+    memset(&s_ap_clients[hole], 0, sizeof(s_ap_clients[hole]));
+    ap_clients_write_end();
+    return true;
+}
+
+/**
+ * @brief Join-storm protection: takes a token from the join bucket, refilled at one token
+ *        per CONFIG_NET_MANAGER_AP_JOIN_REFILL_MS up to CONFIG_NET_MANAGER_AP_JOIN_BURST.
+ *        A client arriving with the bucket empty is deauthenticated and retries later.
+ *        Must be called with the lock held.
+ * @return true if the client is admitted.
+ */
+static bool ap_admit_client(const wifi_event_ap_staconnected_t *event)
+{
+#if CONFIG_NET_MANAGER_AP_ADMISSION_ENABLED
+    const int64_t refill_us = (int64_t)CONFIG_NET_MANAGER_AP_JOIN_REFILL_MS * 1000;
+    int64_t now = esp_timer_get_time();
+    int64_t refills = (now - s_ap_join_refill_us) / refill_us;
+    if (refills > 0)
+    {
+        s_ap_join_tokens = (s_ap_join_tokens + refills > CONFIG_NET_MANAGER_AP_JOIN_BURST) ? CONFIG_NET_MANAGER_AP_JOIN_BURST : (uint32_t)(s_ap_join_tokens + refills);
+        s_ap_join_refill_us += refills * refill_us;
+    }
+
+    if (s_ap_join_tokens == 0)
+    {
+        s_ap_admission.rate_limited++;
+        ESP_LOGW(TAG, "AP join rate limited, refusing " MACSTR, MAC2STR(event->mac));
+        esp_wifi_deauth_sta(event->aid);
+        return false;
+    }
+    s_ap_join_tokens--;
+#else
+    (void)event;
+#endif
+    s_ap_admission.admitted++;
+    return true;
+}
+
+/**
+ * @brief When a join takes the AP over its policy limit, deauthenticates the client that
+ *        has been idle the longest to make room. Must be called with the lock held.
+ */
+static void ap_evict_idle_client(const uint8_t joining_mac[6])
+{
+#if CONFIG_NET_MANAGER_AP_IDLE_EVICTION_ENABLED
+    if (s_ap_max_clients == 0 || s_status.ap_connected_clients <= s_ap_max_clients)
+        return;
+
+    // Activity is the last frame received from the client, counted by the AP traffic hooks.
+    net_ap_client_t victim = {0};
+    bool found = false;
+    for (int i = 0; i < CONFIG_NET_MANAGER_AP_CLIENT_TABLE_SIZE; i++)
+    {
+        if (!s_ap_clients[i].in_use || memcmp(s_ap_clients[i].client.mac, joining_mac, 6) == 0)
+            continue;
+        net_ap_client_t client;
+        ap_client_snapshot(&s_ap_clients[i], &client);
+        if (!found || client.last_active_us < victim.last_active_us)
+        {
+            victim = client;
+            found = true;
+        }
+    }
+    if (!found)
+        return;
+
+    ESP_LOGI(TAG, "AP full, evicting idle client " MACSTR " (idle %lld ms)", MAC2STR(victim.mac),
+             (long long)((esp_timer_get_time() - victim.last_active_us) / 1000));
+    s_ap_admission.evicted_idle++;
+    esp_wifi_deauth_sta(victim.aid);
+#else
+    (void)joining_mac;
+#endif
+}
+
+/**
+ * @brief Records the DHCP-assigned address of a client. Must be called with the lock held.
+ * @return Association to assignment latency in ms, 0 if the client is unknown.
+ */
+static uint32_t ap_client_set_ip(const uint8_t mac[6], esp_ip4_addr_t ip)
+{
+    int found = ap_client_find(mac);
+    if (found < 0)
+        return 0;
+
+    ap_clients_write_begin();
+    net_ap_client_t *client = &s_ap_clients[found].client;
+    client->ip = ip;
+    client->last_active_us = esp_timer_get_time();
+    if (client->join_to_ip_ms == 0)
+        client->join_to_ip_ms = (uint32_t)((esp_timer_get_time() - client->join_time_us) / 1000) + 1;
+    uint32_t join_to_ip_ms = client->join_to_ip_ms;
+    ap_clients_write_end();
+    return join_to_ip_ms;
+}
+
+/**
+ * @brief Records a DHCP lease. Reuses the entry of the same MAC, then a free or expired
+ *        entry, then the entry closest to expiry. Must be called with the lock held.
+ */
+static void ap_lease_record(const uint8_t mac[6], esp_ip4_addr_t ip, uint32_t join_to_ip_ms)
+{
+    int64_t now = esp_timer_get_time();
+    ap_lease_slot_t *slot = NULL;
+
+    for (int i = 0; i < CONFIG_NET_MANAGER_AP_LEASE_TABLE_SIZE && !slot; i++)
+    {
+        if (s_ap_leases[i].in_use && memcmp(s_ap_leases[i].lease.mac, mac, 6) == 0)
+            slot = &s_ap_leases[i];
+    }
+    for (int i = 0; i < CONFIG_NET_MANAGER_AP_LEASE_TABLE_SIZE && !slot; i++)
+    {
+        if (!s_ap_leases[i].in_use || s_ap_leases[i].lease.expires_time_us <= now)
+            slot = &s_ap_leases[i];
+    }
+    if (!slot)
+    {
+        slot = &s_ap_leases[0];
+        for (int i = 1; i < CONFIG_NET_MANAGER_AP_LEASE_TABLE_SIZE; i++)
+        {
+            if (s_ap_leases[i].lease.expires_time_us < slot->lease.expires_time_us)
+                slot = &s_ap_leases[i];
+        }
+    }
+
+    memcpy(slot->lease.mac, mac, 6);
+    slot->lease.ip = ip;
+    slot->lease.assigned_time_us = now;
+    slot->lease.expires_time_us = now + (int64_t)s_ap_lease_time_min * 60 * 1000000;
+    slot->lease.join_to_ip_ms = join_to_ip_ms;
+    slot->in_use = true;
+    ESP_LOGI(TAG, "AP lease " IPSTR " -> " MACSTR " (%lu ms after join)", IP2STR(&ip), MAC2STR(mac), (unsigned long)join_to_ip_ms);
+}
+
+/**
+ * @brief Applies the subnet, pool, lease time and DNS offer of the AP DHCP server.
+ *        The server must be stopped while its options change.
+ */
+static esp_err_t apply_ap_dhcp_config(const net_config_wifi_ap_t *ap_config)
+{
+    memset(s_ap_leases, 0, sizeof(s_ap_leases));
+    s_ap_lease_time_min = ap_config->dhcp_lease_time_min ? ap_config->dhcp_lease_time_min : DHCPS_DEFAULT_LEASE_TIME_MIN;
+
+    bool custom = ap_config->ip_info.ip.addr != 0 || ap_config->dhcp_pool_start.addr != 0 ||
+                  ap_config->dhcp_lease_time_min != 0 || ap_config->dns_offer.addr != 0;
+    if (!custom)
+        return ESP_OK;
+
+    ESP_RETURN_ON_ERROR(esp_netif_dhcps_stop(s_netif_ap), TAG, "DHCP server stop failed");
+
+    if (ap_config->ip_info.ip.addr != 0)
+    {
+        ESP_RETURN_ON_ERROR(esp_netif_set_ip_info(s_netif_ap, &ap_config->ip_info), TAG, "Static IP failed");
+    }
+
+    if (ap_config->dhcp_pool_start.addr != 0 && ap_config->dhcp_pool_end.addr != 0)
+    {
+        dhcps_lease_t pool = {
+            .enable = true,
+            .start_ip = ap_config->dhcp_pool_start,
+            .end_ip = ap_config->dhcp_pool_end,
+        };
+        ESP_RETURN_ON_ERROR(esp_netif_dhcps_option(s_netif_ap, ESP_NETIF_OP_SET, ESP_NETIF_REQUESTED_IP_ADDRESS, &pool, sizeof(pool)), TAG, "DHCP server option failed");
+    }
+
+    if (ap_config->dhcp_lease_time_min != 0)
+    {
+        uint32_t lease_time = ap_config->dhcp_lease_time_min;
+        ESP_RETURN_ON_ERROR(esp_netif_dhcps_option(s_netif_ap, ESP_NETIF_OP_SET, ESP_NETIF_IP_ADDRESS_LEASE_TIME, &lease_time, sizeof(lease_time)), TAG, "DHCP server option failed");
+    }
+
+    if (ap_config->dns_offer.addr != 0)
+    {
+        esp_netif_dns_info_t dns_info = {.ip.u_addr.ip4 = ap_config->dns_offer, .ip.type = ESP_IPADDR_TYPE_V4};
+        ESP_RETURN_ON_ERROR(esp_netif_set_dns_info(s_netif_ap, ESP_NETIF_DNS_MAIN, &dns_info), TAG, "DNS server config failed");
+        uint8_t offer = OFFER_DNS;
+        ESP_RETURN_ON_ERROR(esp_netif_dhcps_option(s_netif_ap, ESP_NETIF_OP_SET, ESP_NETIF_DOMAIN_NAME_SERVER, &offer, sizeof(offer)), TAG, "DHCP server option failed");
+    }
+
+    ESP_RETURN_ON_ERROR(esp_netif_dhcps_start(s_netif_ap), TAG, "DHCP server start failed");
+    ESP_LOGI(TAG, "AP DHCP server configured, lease time %lu min", (unsigned long)s_ap_lease_time_min);
+    return ESP_OK;
+}
+
+/**
+ * @brief Records the last seen RSSI of a client. Must be called with the lock held.
+ */
+static void ap_client_set_rssi(const uint8_t mac[6], int8_t rssi)
+{
+    int found = ap_client_find(mac);
+    if (found < 0)
+        return;
+
+    ap_clients_write_begin();
+    s_ap_clients[found].client.rssi = rssi;
+    s_ap_clients[found].client.last_active_us = esp_timer_get_time();
+    ap_clients_write_end();
+}
+
+/**
+ * @brief Empties the AP client table. Must be called with the lock held.
+ */
+static void ap_clients_clear(void)
+{
+    ap_clients_write_begin();
+    memset(s_ap_clients, 0, sizeof(s_ap_clients));
+    ap_clients_write_end();
+}
+
+/**
+ * @brief Worker task: runs deferred work items with the component mutex held.
+ */
+static void worker_task(void *arg)
+{
+    net_work_id_t work;
+    while (xQueueReceive(s_work_queue, &work, portMAX_DELAY) == pdTRUE)
+    {
+        if (work == NET_WORK_EXIT)
+            break;
+
+        LOCK();
+        switch (work)
+        {
+        case NET_WORK_AP_CHANNEL_SELECT:
+            ap_auto_channel_select(false);
+            break;
+        case NET_WORK_AP_CHANNEL_REEVAL:
+            ap_auto_channel_select(true);
+            break;
+        case NET_WORK_AP_SUSPEND:
+            ap_policy_apply(true);
+            break;
+        case NET_WORK_AP_RESUME:
+            ap_policy_apply(false);
+            break;
+        case NET_WORK_CONFIG_COMMIT:
+            config_commit();
+            break;
+        case NET_WORK_CONFIG_ROLLBACK:
+            if (s_trial_active)
+            {
+                ESP_LOGW(TAG, "No uplink within %d s, rolling back to the last-known-good config", CONFIG_NET_MANAGER_CONFIG_TRIAL_TIMEOUT_S);
+                config_trial_end(false);
+            }
+            break;
+        case NET_WORK_PS_IDLE:
+            ps_auto_switch(true);
+            break;
+        case NET_WORK_PS_WAKE:
+            ps_auto_switch(false);
+            break;
+        case NET_WORK_GW_PREWARM:
+            gw_prewarm_poll();
+            break;
+        default:
+            break;
+        }
+        UNLOCK();
+    }
+    xSemaphoreGive(s_work_exited);
+    vTaskSuspend(NULL); // net_manager_deinit() deletes the task
+}
+
+/**
+ * @brief Queues a work item for the worker task. Safe from timer callbacks; drops the
+ *        item if the queue is full (all work items are idempotent).
+ */
+static bool post_work(net_work_id_t work)
+{
+    if (!s_work_queue)
+        return false;
+    if (xQueueSend(s_work_queue, &work, 0) != pdPASS)
+    {
+        ESP_LOGW(TAG, "Worker queue full, dropping work item %d", work);
+        return false;
+    }
+    unsigned depth = uxQueueMessagesWaiting(s_work_queue);
+    unsigned peak = atomic_load_explicit(&s_work_queue_peak, memory_order_relaxed);
+    while (depth > peak && !atomic_compare_exchange_weak_explicit(&s_work_queue_peak, &peak, depth, memory_order_relaxed,
+                                                                 memory_order_relaxed))
+        ;
+    return true;
+}
+
+/**
+ * @brief Creates a timer, from the static arena with CONFIG_NET_MANAGER_STATIC_ALLOCATION.
+ *        The timer is dormant until started.
+ */
+static TimerHandle_t timer_create(nm_timer_slot_t slot, const char *name, TickType_t period, UBaseType_t auto_reload,
+                                  void *timer_id, TimerCallbackFunction_t callback)
+{
+#if CONFIG_NET_MANAGER_STATIC_ALLOCATION
+    TimerHandle_t timer = s_arena.timer_handles[slot];
+    if (!timer)
+    {
+        timer = xTimerCreateStatic(name, period, auto_reload, timer_id, callback, &s_arena.timers[slot]);
+        s_arena.timer_handles[slot] = timer;
+        return timer;
+    }
+    // Reuse: xTimerChangePeriod() also starts the timer, so stop it again.
+    vTimerSetTimerID(timer, timer_id);
+    xTimerChangePeriod(timer, period, portMAX_DELAY);
+    xTimerStop(timer, portMAX_DELAY);
+    return timer;
+#else
+    return xTimerCreate(name, period, auto_reload, timer_id, callback);
+#endif
+}
+
+/**
+ * @brief Stops and releases a timer created by timer_create() and clears the handle.
+ */
+static void timer_release(TimerHandle_t *timer)
+{
+    if (!*timer)
+        return;
+#if CONFIG_NET_MANAGER_STATIC_ALLOCATION
+    xTimerStop(*timer, portMAX_DELAY);
+#else
+    xTimerDelete(*timer, portMAX_DELAY);
+#endif
+    *timer = NULL;
+}
+
+/**
+ * @brief Sets the Wi-Fi mode and counts the change, so the AP channel scan, which borrows
+ *        APSTA mode with the lock released, knows whether the mode is still its own.
+ *        Must be called with the lock held.
+ */
+static esp_err_t wifi_set_mode(wifi_mode_t mode)
+{
+    s_wifi_mode_generation++;
+    return esp_wifi_set_mode(mode);
+}
+
+/**
+ * @brief Scores every channel from a scan; lower is better. A BSS counts fully on its own
+ *        channel and partially on channels up to 4 away, weighted by its signal strength.
+ */
+static void ap_score_channels(uint32_t scores[WIFI_CHANNEL_MAX + 1])
+{
+    memset(scores, 0, sizeof(uint32_t) * (WIFI_CHANNEL_MAX + 1));
+    wifi_ap_record_t record;
+    while (esp_wifi_scan_get_ap_record(&record) == ESP_OK)
+    {
+        int rssi_weight = record.rssi + 100; // -100 dBm -> 0, -30 dBm -> 70
+        if (rssi_weight < 1)
+            rssi_weight = 1;
+        for (int ch = 1; ch <= WIFI_CHANNEL_MAX; ch++)
+        {
+            int distance = abs(ch - (int)record.primary);
+            if (distance == 0)
+                scores[ch] += 100; // Per-BSS contention cost, independent of signal
+            if (distance < 5)
+                scores[ch] += (uint32_t)(rssi_weight * (5 - distance));
+        }
+    }
+    esp_wifi_clear_ap_list();
+}
+
+/**
+ * @brief Picks the least congested channel for the soft-AP. In APSTA mode the AP shares
+ *        the STA's channel, so no scan is done. With only_if_better (periodic re-evaluation)
+ *        the AP only moves when no client is connected and the gain is large enough.
+ *        The driver only scans from the STA side, so the AP-only radio runs in APSTA mode
+ *        for the scan and goes back to AP mode after it; the AP keeps running, but it is
+ *        off its channel while the scan visits the others. Runs in the worker with the
+ *        lock held, but releases it while the scan blocks. On return the AP may be gone
+ *        or restarted, a client may have joined, or another caller may have set the mode;
+ *        the mode and the channel are then left to the code that changed them.
+ */
+static void ap_auto_channel_select(bool only_if_better)
+{
+    if (!s_netif_ap || !s_ap_auto_channel)
+        return;
+
+    if (s_netif_sta)
+    {
+        ESP_LOGD(TAG, "APSTA mode, the AP follows the STA channel");
+        return;
+    }
+    if (only_if_better && s_status.ap_connected_clients > 0)
+        return;
+
+    wifi_scan_config_t scan_cfg = {
+        .show_hidden = true,
+        .scan_type = WIFI_SCAN_TYPE_ACTIVE,
+        .scan_time.active = {.min = 0, .max = CONFIG_NET_MANAGER_AP_AUTO_CHANNEL_DWELL_MS},
+    };
+    uint32_t generation = s_ap_generation;
+    esp_err_t err = wifi_set_mode(WIFI_MODE_APSTA);
+    if (err == ESP_OK)
+    {
+        uint32_t mode_generation = s_wifi_mode_generation;
+        UNLOCK();
+        err = esp_wifi_scan_start(&scan_cfg, true);
+        LOCK();
+        if (!s_netif_ap || s_netif_sta || s_ap_generation != generation || s_wifi_mode_generation != mode_generation)
+        {
+            esp_wifi_clear_ap_list();
+            return; // The interfaces or the mode changed meanwhile, their owner set the mode
+        }
+        wifi_set_mode(WIFI_MODE_AP);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "AP channel scan failed (%s)", esp_err_to_name(err));
+        return;
+    }
+
+    uint32_t scores[WIFI_CHANNEL_MAX + 1];
+    ap_score_channels(scores);
+    if (only_if_better && s_status.ap_connected_clients > 0)
+        return; // Joined during the scan
+
+    uint8_t best = 1;
+    for (int ch = 2; ch <= WIFI_CHANNEL_MAX; ch++)
+    {
+        if (scores[ch] < scores[best])
+            best = (uint8_t)ch;
+    }
+
+    wifi_config_t wifi_cfg;
+    if (esp_wifi_get_config(WIFI_IF_AP, &wifi_cfg) != ESP_OK)
+        return;
+    uint8_t current = wifi_cfg.ap.channel;
+    if (best == current)
+        return;
+    if (only_if_better && (uint64_t)scores[best] * 100 > (uint64_t)scores[current] * (100 - CONFIG_NET_MANAGER_AP_AUTO_CHANNEL_MIN_GAIN_PCT))
+        return;
+
+    ESP_LOGI(TAG, "AP channel %d -> %d (score %lu -> %lu)", current, best, (unsigned long)scores[current], (unsigned long)scores[best]);
+    wifi_cfg.ap.channel = best;
+    if (esp_wifi_set_config(WIFI_IF_AP, &wifi_cfg) == ESP_OK)
+        s_ap_channel = best;
+}
+
+#if CONFIG_NET_MANAGER_AP_AUTO_CHANNEL_REEVAL_S > 0
+/**
+ * @brief Periodic AP channel re-evaluation, deferred to the worker (scans block).
+ */
+static void ap_channel_timer_cb(TimerHandle_t timer)
+{
+    post_work(NET_WORK_AP_CHANNEL_REEVAL);
+}
+#endif
+
+/**
+ * @brief Runs the AP setup that needs Wi-Fi running (automatic channel selection, done by
+ *        the worker). Must be called with the lock held.
+ */
+static void ap_post_start(void)
+{
+    if (!s_ap_auto_channel)
+        return;
+
+    post_work(NET_WORK_AP_CHANNEL_SELECT); // The scan blocks, keep it off the caller
+#if CONFIG_NET_MANAGER_AP_AUTO_CHANNEL_REEVAL_S > 0
+    if (!s_ap_channel_timer)
+    {
+        s_ap_channel_timer = timer_create(NM_TIMER_AP_CHANNEL, "nm_ap_chan", pdMS_TO_TICKS(CONFIG_NET_MANAGER_AP_AUTO_CHANNEL_REEVAL_S * 1000),
+                                          pdTRUE, NULL, ap_channel_timer_cb);
+    }
+    if (s_ap_channel_timer)
+        xTimerStart(s_ap_channel_timer, 0);
+#endif
+}
+
+/**
+ * @brief Called on STA association. In APSTA mode the driver moves the AP to the STA's
+ *        channel and announces the move to AP clients with CSA (csa_count beacons ahead);
+ *        this records the move and opens the window in which client drops are attributed
+ *        to it. Must be called with the lock held.
+ */
+static void ap_roam_begin(uint8_t sta_channel)
+{
+    if (!s_netif_ap || s_status.ap_suspended || sta_channel == s_ap_channel)
+        return;
+
+    ESP_LOGI(TAG, "STA on channel %d, AP follows from %d (%d client(s), CSA %d beacons)", sta_channel, s_ap_channel,
+             s_status.ap_connected_clients, CONFIG_NET_MANAGER_AP_CSA_COUNT);
+    s_ap_channel = sta_channel;
+    s_ap_roam.channel_moves++;
+    s_ap_roam.last_move_clients = s_status.ap_connected_clients;
+    s_ap_roam.last_move_lost = 0;
+    s_ap_roam.last_move_time_us = esp_timer_get_time();
+    s_ap_roam_start_us = s_ap_roam.last_move_time_us;
+    // Clients still missing from an earlier move are no longer timed.
+    memset(s_ap_roam_lost, 0, sizeof(s_ap_roam_lost));
+}
+
+/**
+ * @brief Whether a client drop now is attributed to the last AP channel move.
+ */
+static bool ap_roam_window_open(void)
+{
+    if (s_ap_roam_start_us == 0)
+        return false;
+    if (esp_timer_get_time() - s_ap_roam_start_us > (int64_t)CONFIG_NET_MANAGER_AP_ROAM_WINDOW_MS * 1000)
+    {
+        s_ap_roam_start_us = 0;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Counts a client dropped by a channel move and remembers it to time its rejoin.
+ *        Must be called with the lock held.
+ */
+static void ap_roam_client_lost(const uint8_t mac[6])
+{
+    s_ap_roam.clients_lost++;
+    s_ap_roam.last_move_lost++;
+    for (int i = 0; i < CONFIG_NET_MANAGER_AP_CLIENT_TABLE_SIZE; i++)
+    {
+        if (!s_ap_roam_lost[i].in_use || memcmp(s_ap_roam_lost[i].mac, mac, 6) == 0)
+        {
+            memcpy(s_ap_roam_lost[i].mac, mac, 6);
+            s_ap_roam_lost[i].in_use = true;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Measures the reconnect time (channel move to re-association) of a client lost
+ *        by the last channel move. Must be called with the lock held.
+ */
+static void ap_roam_client_rejoined(const uint8_t mac[6])
+{
+    for (int i = 0; i < CONFIG_NET_MANAGER_AP_CLIENT_TABLE_SIZE; i++)
+    {
+        if (!s_ap_roam_lost[i].in_use || memcmp(s_ap_roam_lost[i].mac, mac, 6) != 0)
+            continue;
+
+        uint32_t rejoin_ms = (uint32_t)((esp_timer_get_time() - s_ap_roam.last_move_time_us) / 1000);
+        s_ap_roam_lost[i].in_use = false;
+        s_ap_roam.clients_rejoined++;
+        s_ap_rejoin_ms_total += rejoin_ms;
+        s_ap_roam.avg_rejoin_ms = (uint32_t)(s_ap_rejoin_ms_total / s_ap_roam.clients_rejoined);
+        if (rejoin_ms > s_ap_roam.max_rejoin_ms)
+            s_ap_roam.max_rejoin_ms = rejoin_ms;
+        ESP_LOGI(TAG, "AP client " MACSTR " rejoined %lu ms after the channel move", MAC2STR(mac), (unsigned long)rejoin_ms);
+        return;
+    }
+}
+
+/**
+ * @brief Brings up the AP in s_ap_config while Wi-Fi may already run the STA: the STA
+ *        keeps its connection, only the mode changes. Must be called with the lock held.
+ */
+static esp_err_t ap_runtime_start(void)
+{
+    esp_err_t err = ESP_OK;
+    if (!s_netif_sta)
+        err = wifi_driver_init(&s_running_config);
+
+    // The netif must exist before the AP starts so it catches WIFI_EVENT_AP_START.
+    if (err == ESP_OK)
+    {
+        mem_sample_t mem;
+        mem_sample(&mem);
+        err = create_ap_netif(&s_ap_config);
+        if (err == ESP_OK)
+            err = wifi_set_mode(s_netif_sta ? WIFI_MODE_APSTA : WIFI_MODE_AP);
+        if (err == ESP_OK)
+            err = configure_ap(&s_ap_config);
+        mem_phase_end(NET_MEM_PHASE_AP, &mem);
+    }
+    if (err == ESP_OK && !s_netif_sta)
+        err = wifi_driver_start();
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to enable AP (%s)", esp_err_to_name(err));
+        if (s_netif_ap)
+        {
+            esp_netif_tcpip_exec(traffic_hook_remove, (void *)(intptr_t)NET_EVENT_SOURCE_AP);
+            esp_netif_destroy_default_wifi(s_netif_ap);
+        }
+        s_netif_ap = NULL;
+        return err;
+    }
+    ap_post_start();
+    return ESP_OK;
+}
+
+/**
+ * @brief Takes the AP down and releases its netif; a running STA stays connected.
+ *        Must be called with the lock held.
+ */
+static void ap_runtime_stop(void)
+{
+    TimerHandle_t *timers[] = {&s_ap_channel_timer, &s_ap_off_timer, &s_ap_on_timer};
+    for (size_t i = 0; i < sizeof(timers) / sizeof(timers[0]); i++)
+        timer_release(timers[i]);
+    stop_source_tracking(NET_EVENT_SOURCE_AP);
+
+    if (s_netif_sta)
+    {
+        wifi_set_mode(WIFI_MODE_STA);
+    }
+    else
+    {
+        esp_wifi_stop();
+        esp_wifi_deinit();
+    }
+    esp_netif_tcpip_exec(traffic_hook_remove, (void *)(intptr_t)NET_EVENT_SOURCE_AP);
+    esp_netif_destroy_default_wifi(s_netif_ap);
+    s_netif_ap = NULL;
+
+    ap_clients_clear();
+    memset(&s_status.ap_ip_info, 0, sizeof(s_status.ap_ip_info));
+    s_status.ap_status = NET_STATUS_STOPPED;
+    s_status.ap_suspended = false;
+}
+
+/**
+ * @brief Provisioning AP policy timer expiry, deferred to the worker (mode switches block).
+ */
+static void ap_policy_timer_cb(TimerHandle_t timer)
+{
+    post_work((net_work_id_t)(intptr_t)pvTimerGetTimerID(timer));
+}
+
+/**
+ * @brief Sets up the provisioning AP policy for an APSTA start. Must be called with the lock held.
+ */
+static void ap_policy_init(const net_config_wifi_ap_t *ap_config)
+{
+    s_ap_auto_off_delay_s = ap_config->auto_off_delay_s;
+    s_ap_auto_on_delay_s = ap_config->auto_on_delay_s;
+    s_ap_auto_on_failed_retries = ap_config->auto_on_failed_retries;
+    if (s_ap_auto_off_delay_s == 0)
+        return;
+
+    s_ap_off_timer = timer_create(NM_TIMER_AP_OFF, "nm_ap_off", pdMS_TO_TICKS(s_ap_auto_off_delay_s * 1000), pdFALSE,
+                                  (void *)(intptr_t)NET_WORK_AP_SUSPEND, ap_policy_timer_cb);
+    if (s_ap_auto_on_delay_s)
+    {
+        s_ap_on_timer = timer_create(NM_TIMER_AP_ON, "nm_ap_on", pdMS_TO_TICKS(s_ap_auto_on_delay_s * 1000), pdFALSE,
+                                     (void *)(intptr_t)NET_WORK_AP_RESUME, ap_policy_timer_cb);
+    }
+    if (!s_ap_off_timer || (s_ap_auto_on_delay_s && !s_ap_on_timer))
+        ESP_LOGE(TAG, "Failed to create AP policy timers, AP stays on");
+}
+
+/**
+ * @brief Arms or disarms the AP policy timers from the current STA/AP state. Called after
+ *        every handled event, must be called with the lock held.
+ */
+static void ap_policy_evaluate(void)
+{
+    if (!s_ap_off_timer || !s_netif_ap || !s_netif_sta)
+        return;
+
+    bool sta_up = (s_status.sta_status == NET_STATUS_CONNECTED);
+    if (!s_status.ap_suspended)
+    {
+        if (sta_up && s_status.ap_connected_clients == 0)
+        {
+            if (!xTimerIsTimerActive(s_ap_off_timer))
+                xTimerReset(s_ap_off_timer, 0);
+        }
+        else
+        {
+            xTimerStop(s_ap_off_timer, 0);
+        }
+        return;
+    }
+
+    if (sta_up)
+    {
+        if (s_ap_on_timer)
+            xTimerStop(s_ap_on_timer, 0);
+        return;
+    }
+    if (s_ap_auto_on_failed_retries && s_sta_retry_count >= s_ap_auto_on_failed_retries)
+    {
+        post_work(NET_WORK_AP_RESUME);
+        return;
+    }
+    if (s_ap_on_timer && !xTimerIsTimerActive(s_ap_on_timer))
+        xTimerReset(s_ap_on_timer, 0);
+}
+
+/**
+ * @brief Suspends or resumes the AP by switching between STA and APSTA mode. The STA
+ *        connection and the AP netif are kept. Conditions are re-checked because they may
+ *        have changed since the timer fired. Must be called with the lock held.
+ */
+static void ap_policy_apply(bool suspend)
+{
+    if (!s_netif_ap || !s_netif_sta || suspend == s_status.ap_suspended)
+        return;
+
+    bool sta_up = (s_status.sta_status == NET_STATUS_CONNECTED);
+    if (suspend && (!sta_up || s_status.ap_connected_clients > 0))
+        return;
+    if (!suspend && sta_up)
+        return;
+
+    ESP_LOGI(TAG, "%s provisioning AP (STA %s)", suspend ? "Suspending" : "Resuming", sta_up ? "stable" : "down");
+    esp_err_t err = wifi_set_mode(suspend ? WIFI_MODE_STA : WIFI_MODE_APSTA);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to switch Wi-Fi mode (%s)", esp_err_to_name(err));
+        return;
+    }
+    s_status.ap_suspended = suspend;
+    ap_policy_evaluate();
+}
+
+#if CONFIG_NET_MANAGER_FACTORY_CONFIG_ENABLED
+// Factory config partition layout: this header, then `length` bytes of nm_config_encode() output.
+typedef struct __attribute__((packed)) {
+    uint32_t magic;   // FACTORY_CONFIG_MAGIC
+    uint8_t version;  // Record encoding, NVS_CONFIG_VERSION
+    uint8_t reserved[3];
+    uint32_t length;  // Payload bytes after the header
+    uint32_t crc32;   // esp_rom_crc32_le(0, payload, length)
+} factory_config_header_t;
+
+/**
+ * @brief Applies the factory config partition on top of config. The partition is mapped
+ *        and decoded in place, nothing is copied to the heap.
+ */
+static esp_err_t factory_config_load(net_manager_config_t *config)
+{
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                           CONFIG_NET_MANAGER_FACTORY_PARTITION_LABEL);
+    if (!part)
+        return ESP_ERR_NOT_FOUND;
+
+    factory_config_header_t header;
+    esp_err_t err = esp_partition_read(part, 0, &header, sizeof(header));
+    if (err != ESP_OK)
+        return err;
+    if (header.magic != FACTORY_CONFIG_MAGIC || header.length > part->size - sizeof(header))
+    {
+        ESP_LOGW(TAG, "Partition '%s' holds no factory config", part->label);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const void *mapped;
+    esp_partition_mmap_handle_t map_handle;
+    err = esp_partition_mmap(part, 0, sizeof(header) + header.length, ESP_PARTITION_MMAP_DATA, &mapped, &map_handle);
+    if (err != ESP_OK)
+        return err;
+
+    const uint8_t *payload = (const uint8_t *)mapped + sizeof(header);
+    if (esp_rom_crc32_le(0, payload, header.length) != header.crc32)
+    {
+        ESP_LOGE(TAG, "Factory config CRC mismatch, ignored");
+        esp_partition_munmap(map_handle);
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    nm_config_decode(payload, header.length, config);
+    esp_partition_munmap(map_handle);
+    ESP_LOGI(TAG, "Factory config loaded from partition '%s'", part->label);
+    return ESP_OK;
+}
+#endif
+
+/**
+ * @brief Default config when NVS holds none: the factory partition over the Kconfig defaults.
+ */
+static void get_default_config(net_manager_config_t *config)
+{
+    get_default_config_from_kconfig(config);
+#if CONFIG_NET_MANAGER_FACTORY_CONFIG_ENABLED
+    factory_config_load(config);
+#endif
+}
+
+/**
+ * @brief Builds the NVS key of a config key in the given slot.
+ */
+static const char *nvs_slot_key(char out[NVS_KEY_LEN], const char *key, uint8_t slot)
+{
+    snprintf(out, NVS_KEY_LEN, "%s%s", slot ? "b" : "", key);
+    return out;
+}
+
+/**
+ * @brief Reads all config sections of a slot. Slot 0 falls back to the whole-struct blob
+ *        of the baseline firmware.
+ */
+static esp_err_t nvs_read_config(nvs_handle_t nvs_handle, uint8_t slot, net_manager_config_t *config)
+{
+    char key[NVS_KEY_LEN];
+    uint8_t version = 0;
+    uint8_t buf[NM_CONFIG_SECTION_BUF_SIZE];
+    esp_err_t err = nvs_get_u8(nvs_handle, nvs_slot_key(key, NVS_VERSION_KEY, slot), &version);
+    if (err == ESP_ERR_NVS_NOT_FOUND && slot == 0)
+    {
+        legacy_config_v0_t v0;
+        size_t len = 0;
+        err = nvs_get_blob(nvs_handle, NVS_CONFIG_KEY, NULL, &len);
+        if (err != ESP_OK)
+            return err;
+        if (len != sizeof(v0))
+        {
+            ESP_LOGW(TAG, "NVS config size mismatch. Expected %d, got %d.", sizeof(v0), len);
+            return ESP_FAIL;
+        }
+        err = nvs_get_blob(nvs_handle, NVS_CONFIG_KEY, &v0, &len);
+        if (err != ESP_OK)
+            return err;
+        get_default_config(config); // For the fields added since
+        nm_config_decode_v0(&v0, len, config);
+        return ESP_OK;
+    }
+    if (err != ESP_OK)
+        return err;
+    if (version > NVS_CONFIG_VERSION)
+        ESP_LOGW(TAG, "NVS config version %d is newer than %d, unknown fields are ignored", version, NVS_CONFIG_VERSION);
+
+    get_default_config(config);
+    for (size_t i = 0; i < NM_CONFIG_SECTION_COUNT; i++)
+    {
+        const char *section_key = nm_config_section_key(i);
+        size_t len = sizeof(buf);
+        err = nvs_get_blob(nvs_handle, nvs_slot_key(key, section_key, slot), buf, &len);
+        if (err == ESP_OK && version == NVS_CONFIG_VERSION_RAW && !nm_config_decode_v1_section(i, buf, len, config))
+        {
+            ESP_LOGW(TAG, "NVS section %s has no version %d layout of %d bytes", section_key, version, len);
+            return ESP_FAIL;
+        }
+        if (err == ESP_OK && version != NVS_CONFIG_VERSION_RAW)
+            nm_config_section_decode(i, buf, len, config);
+        if (err == ESP_ERR_NVS_NOT_FOUND && version != NVS_CONFIG_VERSION_RAW)
+            err = ESP_OK; // Section added after this blob was written, keep the defaults
+        if (err != ESP_OK)
+            return err;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Writes the config sections of a slot that differ from s_nvs_config[slot], then
+ *        commits. Updates the mirror and the save counters. Must be called with the lock held.
+ */
+static esp_err_t nvs_write_config(nvs_handle_t nvs_handle, uint8_t slot, const net_manager_config_t *config)
+{
+    // Sections are only comparable once they are stored in the current encoding.
+    char key[NVS_KEY_LEN];
+    uint8_t version = 0;
+    bool has_sections = (nvs_get_u8(nvs_handle, nvs_slot_key(key, NVS_VERSION_KEY, slot), &version) == ESP_OK &&
+                         version == NVS_CONFIG_VERSION);
+    if (!has_sections)
+        s_nvs_config_valid[slot] = false;
+    else if (!s_nvs_config_valid[slot])
+        s_nvs_config_valid[slot] = (nvs_read_config(nvs_handle, slot, &s_nvs_config[slot]) == ESP_OK);
+
+    uint32_t bytes_written = 0;
+    uint8_t sections_written = 0;
+    esp_err_t err = ESP_OK;
+    for (size_t i = 0; i < NM_CONFIG_SECTION_COUNT && err == ESP_OK; i++)
+    {
+        uint8_t buf[NM_CONFIG_SECTION_BUF_SIZE];
+        uint8_t stored[NM_CONFIG_SECTION_BUF_SIZE];
+        size_t len = nm_config_section_encode(i, config, buf, sizeof(buf));
+        if (len == 0)
+        {
+            err = ESP_ERR_NO_MEM;
+            break;
+        }
+        // Compare encodings, so padding and bytes after a string terminator don't count.
+        if (s_nvs_config_valid[slot] && nm_config_section_encode(i, &s_nvs_config[slot], stored, sizeof(stored)) == len &&
+            memcmp(buf, stored, len) == 0)
+            continue;
+        err = nvs_set_blob(nvs_handle, nvs_slot_key(key, nm_config_section_key(i), slot), buf, len);
+        bytes_written += len;
+        sections_written++;
+    }
+
+    if (err == ESP_OK && !has_sections)
+    {
+        err = nvs_set_u8(nvs_handle, nvs_slot_key(key, NVS_VERSION_KEY, slot), NVS_CONFIG_VERSION);
+        bytes_written += sizeof(uint8_t);
+        if (slot == 0)
+            nvs_erase_key(nvs_handle, NVS_CONFIG_KEY); // Superseded by the sections
+    }
+    if (err == ESP_OK && bytes_written > 0)
+        err = nvs_commit(nvs_handle);
+
+    if (err == ESP_OK)
+    {
+        memcpy(&s_nvs_config[slot], config, sizeof(s_nvs_config[slot]));
+        s_nvs_config_valid[slot] = true;
+    }
+    else
+    {
+        s_nvs_config_valid[slot] = false; // Flash state unknown, compare against NVS next time
+    }
+    s_nvs_save_stats.saves++;
+    s_nvs_save_stats.last_bytes_written = bytes_written;
+    s_nvs_save_stats.last_sections_written = sections_written;
+    s_nvs_save_stats.last_sections_skipped = NM_CONFIG_SECTION_COUNT - sections_written;
+    s_nvs_save_stats.total_bytes_written += bytes_written;
+    return err;
+}
+
+/**
+ * @brief Loads the last-known-good config, and a config left on trial by the previous boot
+ *        into s_trial_config. Must be called with the lock held.
+ */
+static esp_err_t load_config(net_manager_config_t *config)
+{
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
+    if (err != ESP_OK)
+        return err;
+
+    uint8_t slot = 0;
+    if (nvs_get_u8(nvs_handle, NVS_SLOT_KEY, &slot) != ESP_OK || slot >= NVS_SLOT_COUNT)
+        slot = 0;
+    s_config_slot = slot;
+    err = nvs_read_config(nvs_handle, slot, config);
+    if (err == ESP_OK)
+    {
+        memcpy(&s_nvs_config[slot], config, sizeof(s_nvs_config[slot]));
+        s_nvs_config_valid[slot] = true;
+    }
+
+    uint8_t trial_slot;
+    if (nvs_get_u8(nvs_handle, NVS_TRIAL_KEY, &trial_slot) == ESP_OK && trial_slot < NVS_SLOT_COUNT && trial_slot != slot &&
+        nvs_read_config(nvs_handle, trial_slot, &s_trial_config) == ESP_OK)
+    {
+        ESP_LOGW(TAG, "Config trial interrupted by a restart, resuming it");
+        s_trial_pending = true;
+    }
+    nvs_close(nvs_handle);
+
+    ESP_LOGI(TAG, "Configuration loaded from NVS %s", (err == ESP_OK) ? "successfully" : "failed (or not found)");
+    return err;
+}
+
+/**
+ * @brief Writes the cached config to NVS if it is dirty. Runs in the worker for deferred
+ *        commits and in the caller for net_manager_flush_config(). Must be called with the lock held.
+ */
+static esp_err_t config_commit(void)
+{
+    if (!s_config_dirty)
+        return ESP_OK;
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error (%s) opening NVS handle!", esp_err_to_name(err));
+        return err;
+    }
+    err = nvs_write_config(nvs_handle, s_config_slot, &s_config);
+    nvs_close(nvs_handle);
+    if (err == ESP_OK)
+        s_config_dirty = false;
+    ESP_LOGI(TAG, "Configuration committed to NVS %s (%lu bytes written)", (err == ESP_OK) ? "successfully" : "failed",
+             (unsigned long)s_nvs_save_stats.last_bytes_written);
+    return err;
+}
+
+/**
+ * @brief Makes config the saved config and schedules its commit. A burst of saves is
+ *        coalesced into one commit, at most one delay after the first.
+ *        Must be called with the lock held.
+ */
+static esp_err_t config_store(const net_manager_config_t *config)
+{
+    memcpy(&s_config, config, sizeof(net_manager_config_t));
+    s_config_stored = true;
+    s_config_dirty = true;
+    if (s_trial_active)
+        s_trial_saved = true;
+    return config_commit_schedule();
+}
+
+/**
+ * @brief Commits the dirty s_config now, or at the write-behind delay if the timer runs.
+ *        Must be called with the lock held.
+ */
+static esp_err_t config_commit_schedule(void)
+{
+    if (!s_config_commit_timer)
+        return config_commit();
+    if (xTimerIsTimerActive(s_config_commit_timer) == pdFALSE)
+        xTimerStart(s_config_commit_timer, 0);
+    return ESP_OK;
+}
+
+/**
+ * @brief Write-behind delay expiry, the commit itself runs in the worker.
+ */
+static void config_commit_timer_cb(TimerHandle_t timer)
+{
+    post_work(NET_WORK_CONFIG_COMMIT);
+}
+
+/**
+ * @brief Starts the deadline of the config on trial. Must be called with the lock held.
+ */
+static void config_trial_arm(void)
+{
+    if (!s_trial_timer)
+    {
+        s_trial_timer = timer_create(NM_TIMER_CONFIG_TRIAL, "nm_trial", pdMS_TO_TICKS(CONFIG_NET_MANAGER_CONFIG_TRIAL_TIMEOUT_S * 1000), pdFALSE,
+                                     NULL, config_trial_timer_cb);
+    }
+    if (!s_trial_timer || xTimerReset(s_trial_timer, 0) != pdPASS)
+        ESP_LOGE(TAG, "Failed to start the config trial timer, no automatic rollback");
+    s_trial_active = true;
+    s_trial_pending = false;
+    s_trial_saved = false;
+}
+
+/**
+ * @brief Clears the trial marker in NVS; with promote, the trial slot also becomes
+ *        last-known-good. Stops the trial timer. Must be called with the lock held.
+ */
+static void config_trial_clear(bool promote)
+{
+    s_trial_active = false;
+    s_trial_pending = false;
+    if (s_trial_timer)
+        xTimerStop(s_trial_timer, 0);
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err == ESP_OK)
+    {
+        if (promote)
+            err = nvs_set_u8(nvs_handle, NVS_SLOT_KEY, s_config_slot ^ 1);
+        if (err == ESP_OK)
+            err = nvs_erase_key(nvs_handle, NVS_TRIAL_KEY);
+        if (err == ESP_OK)
+            err = nvs_commit(nvs_handle);
+        nvs_close(nvs_handle);
+    }
+    if (err != ESP_OK)
+        ESP_LOGE(TAG, "Failed to record the config trial outcome (%s)", esp_err_to_name(err));
+}
+
+/**
+ * @brief Ends the config trial. Confirmed: the trial slot becomes last-known-good, and a
+ *        config saved during the trial is committed over it. Otherwise the last-known-good
+ *        config is restarted and NET_STATUS_CONFIG_ROLLBACK is dispatched, its data pointing
+ *        to the esp_err_t of the restart. Must be called with the lock held.
+ */
+static void config_trial_end(bool confirmed)
+{
+    config_trial_clear(confirmed);
+    if (confirmed)
+    {
+        ESP_LOGI(TAG, "Config trial confirmed, slot %d is now last-known-good", s_config_slot ^ 1);
+        s_config_slot ^= 1;
+        if (s_trial_saved)
+        {
+            // The save is newer than the trial config, it goes to the new slot.
+            s_config_dirty = true;
+            config_commit_schedule();
+        }
+        else
+        {
+            memcpy(&s_config, &s_trial_config, sizeof(s_config));
+            s_config_stored = true;
+            s_config_dirty = false;
+        }
+        s_trial_saved = false;
+        return;
+    }
+
+    net_manager_config_t cfg;
+    if (s_config_stored)
+        memcpy(&cfg, &s_config, sizeof(cfg));
+    else
+        get_default_config(&cfg);
+    stop_all_interfaces();
+    esp_err_t err = start_interfaces(&cfg);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Rollback failed to restart the interfaces (%s)", esp_err_to_name(err));
+        stop_all_interfaces();
+    }
+    if (s_user_callback)
+    {
+        net_manager_event_t ev = {.source = NET_EVENT_SOURCE_CONFIG, .status = NET_STATUS_CONFIG_ROLLBACK, .data = &err};
+        s_user_callback(&ev);
+    }
+}
+
+/**
+ * @brief Trial deadline expiry, the rollback runs in the worker.
+ */
+static void config_trial_timer_cb(TimerHandle_t timer)
+{
+    post_work(NET_WORK_CONFIG_ROLLBACK);
+}
+
+/**
+ * @brief Brings up the interfaces enabled in cfg. Must be called with the lock held and
+ *        all interfaces stopped. On error the interfaces may be partly up.
+ */
+static esp_err_t start_interfaces(const net_manager_config_t *cfg)
+{
+    memcpy(&s_running_config, cfg, sizeof(s_running_config));
+    esp_err_t err = start_wifi(cfg);
+    if (err == ESP_OK && cfg->ethernet_enabled)
+        err = start_eth(&cfg->ethernet_config);
+    return err;
+}
+
+/**
+ * @brief Brings up the STA and/or AP enabled in cfg. Must be called with the lock held
+ *        and Wi-Fi stopped.
+ */
+static esp_err_t start_wifi(const net_manager_config_t *cfg)
+{
+    // An on-demand AP is only declared here; net_manager_ap_enable() allocates it.
+    bool is_ap_active = cfg->wifi_ap_enabled && !cfg->wifi_ap_config.on_demand;
+    if (cfg->wifi_ap_enabled)
+    {
+        s_ap_declared = true;
+        memcpy(&s_ap_config, &cfg->wifi_ap_config, sizeof(s_ap_config));
+    }
+
+    bool is_wifi_needed = cfg->wifi_sta_enabled || is_ap_active;
+    if (is_wifi_needed)
+    {
+        ESP_RETURN_ON_ERROR(wifi_driver_init(cfg), TAG, "Wi-Fi driver init failed");
+
+        wifi_mode_t mode = WIFI_MODE_NULL;
+        if (cfg->wifi_sta_enabled && is_ap_active)
+            mode = WIFI_MODE_APSTA;
+        else if (cfg->wifi_sta_enabled)
+            mode = WIFI_MODE_STA;
+        else if (is_ap_active)
+            mode = WIFI_MODE_AP;
+
+        if (mode != WIFI_MODE_NULL)
+        {
+            ESP_RETURN_ON_ERROR(wifi_set_mode(mode), TAG, "Wi-Fi mode failed");
+        }
+    }
+
+    mem_sample_t mem;
+    esp_err_t err = ESP_OK;
+    if (cfg->wifi_sta_enabled)
+    {
+        mem_sample(&mem);
+        err = start_sta(&cfg->wifi_sta_config);
+        mem_phase_end(NET_MEM_PHASE_STA, &mem);
+    }
+    if (err == ESP_OK && is_ap_active)
+    {
+        mem_sample(&mem);
+        err = start_ap(&cfg->wifi_ap_config);
+        mem_phase_end(NET_MEM_PHASE_AP, &mem);
+    }
+    if (err != ESP_OK)
+        return err;
+
+    if (is_wifi_needed)
+    {
+        ESP_RETURN_ON_ERROR(wifi_driver_start(), TAG, "Wi-Fi start failed");
+    }
+    if (cfg->wifi_sta_enabled)
+        ps_apply();
+
+    if (cfg->wifi_sta_enabled && is_ap_active)
+        ap_policy_init(&cfg->wifi_ap_config);
+
+    if (is_ap_active)
+        ap_post_start();
+    return ESP_OK;
+}
+
+/**
+ * @brief Whether section i encodes identically in a and b (padding and unused string
+ *        bytes don't count).
+ */
+static bool config_section_equal(size_t i, const net_manager_config_t *a, const net_manager_config_t *b)
+{
+    uint8_t enc_a[NM_CONFIG_SECTION_BUF_SIZE];
+    uint8_t enc_b[NM_CONFIG_SECTION_BUF_SIZE];
+    size_t len_a = nm_config_section_encode(i, a, enc_a, sizeof(enc_a));
+    size_t len_b = nm_config_section_encode(i, b, enc_b, sizeof(enc_b));
+    return len_a == len_b && memcmp(enc_a, enc_b, len_a) == 0;
+}
+
+/**
+ * @brief Switches the running interfaces to cfg, restarting only what differs: Ethernet
+ *        and Wi-Fi independently, and within Wi-Fi only the AP if the STA is unchanged.
+ *        Must be called with the lock held. On error the interfaces may be partly up.
+ */
+static esp_err_t switch_interfaces(const net_manager_config_t *cfg)
+{
+    const net_manager_config_t *old = &s_running_config;
+    bool eth_same = old->ethernet_enabled == cfg->ethernet_enabled &&
+                    (!cfg->ethernet_enabled || config_section_equal(NM_CONFIG_SECTION_ETH, old, cfg));
+    bool sta_same = old->wifi_sta_enabled == cfg->wifi_sta_enabled &&
+                    (!cfg->wifi_sta_enabled || config_section_equal(NM_CONFIG_SECTION_STA, old, cfg));
+    bool ap_same = old->wifi_ap_enabled == cfg->wifi_ap_enabled &&
+                   (!cfg->wifi_ap_enabled || config_section_equal(NM_CONFIG_SECTION_AP, old, cfg));
+    // New Wi-Fi buffers only take effect when the driver is initialized again.
+    net_wifi_buffers_t old_buffers, new_buffers;
+    wifi_buffers_resolve(old, &old_buffers);
+    wifi_buffers_resolve(cfg, &new_buffers);
+    bool wifi_same = sta_same && memcmp(&old_buffers, &new_buffers, sizeof(old_buffers)) == 0;
+
+    esp_err_t err = ESP_OK;
+    if (!eth_same)
+    {
+        stop_eth();
+        if (cfg->ethernet_enabled)
+            err = start_eth(&cfg->ethernet_config);
+    }
+
+    if (!wifi_same || (!ap_same && !cfg->wifi_sta_enabled))
+    {
+        stop_wifi();
+        esp_err_t wifi_err = start_wifi(cfg);
+        if (err == ESP_OK)
+            err = wifi_err;
+    }
+    else if (!ap_same)
+    {
+        // The STA stays associated, only the AP is replaced.
+        if (s_netif_ap)
+            ap_runtime_stop();
+        s_ap_declared = cfg->wifi_ap_enabled;
+        memcpy(&s_ap_config, &cfg->wifi_ap_config, sizeof(s_ap_config));
+        if (cfg->wifi_ap_enabled && !cfg->wifi_ap_config.on_demand)
+        {
+            esp_err_t ap_err = ap_runtime_start();
+            if (ap_err == ESP_OK)
+                ap_policy_init(&s_ap_config);
+            else if (err == ESP_OK)
+                err = ap_err;
+        }
+    }
+    ESP_LOGI(TAG, "Interfaces switched (ETH %s, STA %s, AP %s)", eth_same ? "kept" : "restarted",
+             wifi_same ? "kept" : "restarted", ap_same ? "kept" : "restarted");
+    memcpy(&s_running_config, cfg, sizeof(s_running_config));
+    return err;
+}
+
+/**
+ * @brief Reads the profile index. A missing index is empty; an index written with a
+ *        smaller CONFIG_NET_MANAGER_MAX_PROFILES is padded with empty entries. Any other
+ *        read error or size fails, the index is never rewritten from a partial read.
+ */
+static esp_err_t profile_index_load(nvs_handle_t nvs_handle, profile_name_t index[CONFIG_NET_MANAGER_MAX_PROFILES])
+{
+    memset(index, 0, sizeof(profile_name_t) * CONFIG_NET_MANAGER_MAX_PROFILES);
+    size_t index_size = sizeof(profile_name_t) * CONFIG_NET_MANAGER_MAX_PROFILES;
+    esp_err_t err = nvs_get_blob(nvs_handle, NVS_PROFILE_INDEX_KEY, index, &index_size);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+        return ESP_OK;
+    if (err == ESP_OK && index_size % sizeof(profile_name_t) != 0)
+        err = ESP_ERR_INVALID_SIZE;
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Profile index unreadable (%s)", esp_err_to_name(err));
+        return err;
+    }
+    for (int i = 0; i < CONFIG_NET_MANAGER_MAX_PROFILES; i++)
+        index[i][NET_MANAGER_PROFILE_NAME_MAX] = '\0';
+    return ESP_OK;
+}
+
+/**
+ * @brief Builds the NVS key of a profile.
+ */
+static const char *profile_key(char out[NVS_KEY_LEN], const char *name)
+{
+    snprintf(out, NVS_KEY_LEN, "p_%s", name);
+    return out;
+}
+
+/**
+ * @brief Samples free heap and the largest free block of internal RAM and SPIRAM.
+ */
+static void mem_sample(mem_sample_t *sample)
+{
+    sample->internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    sample->internal_largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+    sample->spiram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    sample->spiram_largest = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+}
+
+/**
+ * @brief Records the heap consumed by a phase since before was sampled.
+ *        Must be called with the lock held.
+ */
+static void mem_phase_end(net_mem_phase_t phase, const mem_sample_t *before)
+{
+    mem_sample_t after;
+    mem_sample(&after);
+    net_mem_phase_cost_t *cost = &s_mem_phases[phase];
+    cost->internal_bytes = (int32_t)(before->internal_free - after.internal_free);
+    cost->internal_largest_block = (int32_t)(before->internal_largest - after.internal_largest);
+    cost->spiram_bytes = (int32_t)(before->spiram_free - after.spiram_free);
+    cost->spiram_largest_block = (int32_t)(before->spiram_largest - after.spiram_largest);
+    cost->runs++;
+    ESP_LOGD(TAG, "Memory phase %d: %ld bytes internal, %ld bytes SPIRAM", phase, (long)cost->internal_bytes,
+             (long)cost->spiram_bytes);
+}
+
+/**
+ * @brief Resolves the Wi-Fi buffer profile of cfg to buffer counts. Padding is zeroed, so
+ *        two results can be compared with memcmp().
+ */
+static void wifi_buffers_resolve(const net_manager_config_t *cfg, net_wifi_buffers_t *buffers)
+{
+    memset(buffers, 0, sizeof(*buffers));
+    switch (cfg->wifi_buffer_profile)
+    {
+    case NET_WIFI_BUFFERS_LOW_MEMORY:
+        buffers->static_rx_buf_num = 4;
+        buffers->dynamic_rx_buf_num = 8;
+        buffers->dynamic_tx_buf_num = 8;
+        break;
+    case NET_WIFI_BUFFERS_BALANCED:
+        buffers->static_rx_buf_num = 10;
+        buffers->dynamic_rx_buf_num = 32;
+        buffers->dynamic_tx_buf_num = 32;
+        buffers->ampdu_rx_win = 6;
+        buffers->ampdu_tx_enable = true;
+        break;
+    case NET_WIFI_BUFFERS_HIGH_THROUGHPUT:
+        buffers->static_rx_buf_num = 16;
+        buffers->dynamic_rx_buf_num = 64;
+        buffers->dynamic_tx_buf_num = 64;
+        buffers->cache_tx_buf_num = 32;
+        buffers->ampdu_rx_win = 32;
+        buffers->ampdu_tx_enable = true;
+        break;
+    case NET_WIFI_BUFFERS_CUSTOM:
+        buffers->static_rx_buf_num = cfg->wifi_buffers.static_rx_buf_num;
+        buffers->dynamic_rx_buf_num = cfg->wifi_buffers.dynamic_rx_buf_num;
+        buffers->static_tx_buf_num = cfg->wifi_buffers.static_tx_buf_num;
+        buffers->dynamic_tx_buf_num = cfg->wifi_buffers.dynamic_tx_buf_num;
+        buffers->cache_tx_buf_num = cfg->wifi_buffers.cache_tx_buf_num;
+        buffers->ampdu_rx_win = cfg->wifi_buffers.ampdu_rx_win;
+        buffers->ampdu_tx_enable = cfg->wifi_buffers.ampdu_tx_enable;
+        buffers->nvs_enable = cfg->wifi_buffers.nvs_enable;
+        break;
+    default:
+    {
+        wifi_init_config_t defaults = WIFI_INIT_CONFIG_DEFAULT();
+        buffers->static_rx_buf_num = defaults.static_rx_buf_num;
+        buffers->dynamic_rx_buf_num = defaults.dynamic_rx_buf_num;
+        buffers->static_tx_buf_num = (defaults.tx_buf_type == 0) ? defaults.static_tx_buf_num : 0;
+        buffers->dynamic_tx_buf_num = defaults.dynamic_tx_buf_num;
+        buffers->cache_tx_buf_num = defaults.cache_tx_buf_num;
+        buffers->ampdu_rx_win = defaults.ampdu_rx_enable ? defaults.rx_ba_win : 0;
+        buffers->ampdu_tx_enable = defaults.ampdu_tx_enable;
+        buffers->nvs_enable = defaults.nvs_enable;
+        break;
+    }
+    }
+#if !CONFIG_SPIRAM
+    buffers->cache_tx_buf_num = 0; // The TX cache lives in SPIRAM
+#endif
+}
+
+/**
+ * @brief Initializes the Wi-Fi driver with the buffer profile of cfg, recording its heap cost.
+ */
+static esp_err_t wifi_driver_init(const net_manager_config_t *cfg)
+{
+    net_wifi_buffers_t buffers;
+    wifi_buffers_resolve(cfg, &buffers);
+    wifi_init_config_t wifi_init_cfg = WIFI_INIT_CONFIG_DEFAULT();
+    wifi_init_cfg.static_rx_buf_num = buffers.static_rx_buf_num;
+    wifi_init_cfg.dynamic_rx_buf_num = buffers.dynamic_rx_buf_num;
+    wifi_init_cfg.tx_buf_type = (buffers.static_tx_buf_num > 0) ? 0 : 1; // 0 = static, 1 = dynamic
+    wifi_init_cfg.static_tx_buf_num = buffers.static_tx_buf_num;
+    wifi_init_cfg.dynamic_tx_buf_num = buffers.dynamic_tx_buf_num;
+    wifi_init_cfg.cache_tx_buf_num = buffers.cache_tx_buf_num;
+    wifi_init_cfg.ampdu_rx_enable = (buffers.ampdu_rx_win > 0);
+    if (buffers.ampdu_rx_win > 0)
+        wifi_init_cfg.rx_ba_win = buffers.ampdu_rx_win;
+    wifi_init_cfg.ampdu_tx_enable = buffers.ampdu_tx_enable;
+    wifi_init_cfg.nvs_enable = buffers.nvs_enable;
+    ESP_LOGI(TAG, "Wi-Fi buffers: RX %u static / %u dynamic, TX %u static / %u dynamic, AMPDU RX window %u",
+             buffers.static_rx_buf_num, buffers.dynamic_rx_buf_num, buffers.static_tx_buf_num,
+             buffers.dynamic_tx_buf_num, buffers.ampdu_rx_win);
+
+    mem_sample_t mem;
+    mem_sample(&mem);
+    esp_err_t err = esp_wifi_init(&wifi_init_cfg);
+    mem_phase_end(NET_MEM_PHASE_WIFI_INIT, &mem);
+#if CONFIG_NET_MANAGER_AP_IDLE_EVICTION_ENABLED
+    // WIFI_EVENT_AP_PROBEREQRECVED is masked by default. Unmasked, every probe request in
+    // range posts an event, so only idle eviction pays for it (client RSSI and activity).
+    if (err == ESP_OK)
+        esp_wifi_set_event_mask(WIFI_EVENT_MASK_NONE);
+#endif
+    return err;
+}
+
+/**
+ * @brief Starts the Wi-Fi driver, recording its heap cost.
+ */
+static esp_err_t wifi_driver_start(void)
+{
+    mem_sample_t mem;
+    mem_sample(&mem);
+    esp_err_t err = esp_wifi_start();
+    mem_phase_end(NET_MEM_PHASE_WIFI_START, &mem);
+    return err;
+}
+
+#if CONFIG_NET_MANAGER_TRAFFIC_HOOKS_ENABLED
+/**
+ * @brief Notes a frame seen by the traffic hooks. Runs in the Wi-Fi/Ethernet RX task or
+ *        the TCP/IP task, so it only touches atomics and posts work.
+ */
+static void traffic_seen(net_event_source_t source, bool tx)
+{
+    if (source != NET_EVENT_SOURCE_STA)
+        return;
+    atomic_store_explicit(&s_sta_activity_ms, (uint32_t)(esp_timer_get_time() / 1000), memory_order_relaxed);
+    // The first transmitted frame in the idle state brings AUTO mode back to max performance.
+    if (tx && atomic_load_explicit(&s_ps_low_power, memory_order_relaxed) &&
+        atomic_exchange_explicit(&s_ps_low_power, false, memory_order_relaxed) && !post_work(NET_WORK_PS_WAKE))
+        atomic_store_explicit(&s_ps_low_power, true, memory_order_relaxed); // Retry on the next frame
+}
+
+/**
+ * @brief Counts a frame, or a drop if it was refused. Only the single writer of the
+ *        counter may call this.
+ */
+static void traffic_count(traffic_counter_t *counter, uint16_t len, bool accepted)
+{
+    unsigned seq = atomic_load_explicit(&counter->seq, memory_order_relaxed);
+    atomic_store_explicit(&counter->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    if (accepted)
+    {
+        counter->bytes += len;
+        counter->packets++;
+    }
+    else
+    {
+        counter->dropped++;
+    }
+    atomic_store_explicit(&counter->seq, seq + 2, memory_order_release);
+}
+
+/**
+ * @brief Counts a unicast frame to or from a soft-AP client. Runs in the Wi-Fi RX task or
+ *        the TCP/IP task, which may have preempted a client table writer: the table is
+ *        read once under its sequence counter, and a frame that races a join or leave is
+ *        not counted rather than retried.
+ */
+static void ap_client_count(const uint8_t mac[6], int dir, uint16_t len)
+{
+    if (mac[0] & 0x01)
+        return; // Group address
+    unsigned seq = atomic_load_explicit(&s_ap_clients_seq, memory_order_acquire);
+    if (seq & 1)
+        return;
+    int found = ap_client_find(mac);
+    uint8_t stats_idx = (found >= 0) ? s_ap_clients[found].stats_idx : 0;
+    atomic_thread_fence(memory_order_acquire);
+    if (found < 0 || atomic_load_explicit(&s_ap_clients_seq, memory_order_relaxed) != seq)
+        return;
+
+    int64_t now = esp_timer_get_time();
+    ap_client_counter_t *counter = &s_ap_client_traffic[stats_idx][dir];
+    unsigned counter_seq = atomic_load_explicit(&counter->seq, memory_order_relaxed);
+    atomic_store_explicit(&counter->seq, counter_seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    counter->bytes += len;
+    counter->last_us = now;
+    atomic_store_explicit(&counter->seq, counter_seq + 2, memory_order_release);
+}
+
+#endif
+
+/**
+ * @brief Copies a client table entry and adds its traffic: byte counts, and the last frame
+ *        received from it as activity. Part of a table read.
+ */
+static void ap_client_snapshot(const ap_client_slot_t *slot, net_ap_client_t *client)
+{
+    *client = slot->client;
+    ap_client_counter_t copy[TRAFFIC_DIRS];
+    for (int dir = 0; dir < TRAFFIC_DIRS; dir++)
+    {
+        const ap_client_counter_t *counter = &s_ap_client_traffic[slot->stats_idx][dir];
+        unsigned seq_before, seq_after;
+        do
+        {
+            seq_before = atomic_load_explicit(&counter->seq, memory_order_acquire);
+            copy[dir].bytes = counter->bytes;
+            copy[dir].last_us = counter->last_us;
+            atomic_thread_fence(memory_order_acquire);
+            seq_after = atomic_load_explicit(&counter->seq, memory_order_relaxed);
+        } while ((seq_before & 1) || seq_before != seq_after);
+    }
+    client->rx_bytes = copy[TRAFFIC_RX].bytes;
+    client->tx_bytes = copy[TRAFFIC_TX].bytes;
+    if (copy[TRAFFIC_RX].last_us > client->last_active_us)
+        client->last_active_us = copy[TRAFFIC_RX].last_us;
+}
+
+#if CONFIG_NET_MANAGER_TRAFFIC_HOOKS_ENABLED
+/**
+ * @brief lwIP input hook: notes and counts the frame and passes it on.
+ */
+static err_t traffic_hook_input(struct pbuf *p, struct netif *netif)
+{
+    for (int i = 0; i < NET_SOURCE_COUNT; i++)
+    {
+        if (s_traffic_hooks[i].netif == netif)
+        {
+            traffic_seen((net_event_source_t)i, false);
+            // p belongs to the stack once it is accepted, read what is counted first.
+            uint16_t len = p->tot_len;
+            uint8_t src_mac[6];
+            bool from_ap_client = (i == NET_EVENT_SOURCE_AP && p->len >= 12);
+            if (from_ap_client)
+                memcpy(src_mac, (const uint8_t *)p->payload + 6, 6);
+            err_t err = s_traffic_hooks[i].input(p, netif);
+            traffic_count(&s_traffic[i][TRAFFIC_RX], len, err == ERR_OK);
+            if (from_ap_client && err == ERR_OK)
+                ap_client_count(src_mac, TRAFFIC_RX, len);
+            return err;
+        }
+    }
+    return ERR_IF; // The caller frees p on an error
+}
+
+/**
+ * @brief lwIP linkoutput hook: notes and counts the frame and passes it on.
+ */
+static err_t traffic_hook_linkoutput(struct netif *netif, struct pbuf *p)
+{
+    for (int i = 0; i < NET_SOURCE_COUNT; i++)
+    {
+        if (s_traffic_hooks[i].netif == netif)
+        {
+            traffic_seen((net_event_source_t)i, true);
+            err_t err = s_traffic_hooks[i].linkoutput(netif, p);
+            traffic_count(&s_traffic[i][TRAFFIC_TX], p->tot_len, err == ERR_OK);
+            if (i == NET_EVENT_SOURCE_AP && err == ERR_OK && p->len >= 6)
+                ap_client_count((const uint8_t *)p->payload, TRAFFIC_TX, p->tot_len);
+            return err;
+        }
+    }
+    return ERR_IF;
+}
+
+#endif
+
+/**
+ * @brief Reads the traffic counters of a source without blocking its writers.
+ */
+static void traffic_read(net_event_source_t source, net_traffic_stats_t *stats)
+{
+    traffic_counter_t copy[TRAFFIC_DIRS];
+    for (int dir = 0; dir < TRAFFIC_DIRS; dir++)
+    {
+        traffic_counter_t *counter = &s_traffic[source][dir];
+        unsigned seq_before, seq_after;
+        do
+        {
+            seq_before = atomic_load_explicit(&counter->seq, memory_order_acquire);
+            copy[dir].bytes = counter->bytes;
+            copy[dir].packets = counter->packets;
+            copy[dir].dropped = counter->dropped;
+            atomic_thread_fence(memory_order_acquire);
+            seq_after = atomic_load_explicit(&counter->seq, memory_order_relaxed);
+        } while ((seq_before & 1) || seq_before != seq_after);
+    }
+    stats->rx_bytes = copy[TRAFFIC_RX].bytes;
+    stats->rx_packets = copy[TRAFFIC_RX].packets;
+    stats->rx_dropped = copy[TRAFFIC_RX].dropped;
+    stats->tx_bytes = copy[TRAFFIC_TX].bytes;
+    stats->tx_packets = copy[TRAFFIC_TX].packets;
+    stats->tx_dropped = copy[TRAFFIC_TX].dropped;
+}
+
+/**
+ * @brief Interposes the traffic hooks on the lwIP netif of a source (ctx).
+ *        Runs in the TCP/IP task.
+ */
+static esp_err_t traffic_hook_install(void *ctx)
+{
+#if CONFIG_NET_MANAGER_TRAFFIC_HOOKS_ENABLED
+    net_event_source_t source = (net_event_source_t)(intptr_t)ctx;
+    struct netif *lwip_netif = esp_netif_get_netif_impl(netif_from_source(source));
+    if (!lwip_netif)
+        return ESP_ERR_INVALID_STATE;
+    if (lwip_netif->input == traffic_hook_input)
+        return ESP_OK;
+    // No frames flow before the interface starts, so the counters can be reset here.
+    for (int dir = 0; dir < TRAFFIC_DIRS; dir++)
+    {
+        traffic_counter_t *counter = &s_traffic[source][dir];
+        unsigned seq = atomic_load_explicit(&counter->seq, memory_order_relaxed);
+        atomic_store_explicit(&counter->seq, seq + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        counter->bytes = 0;
+        counter->packets = 0;
+        counter->dropped = 0;
+        atomic_store_explicit(&counter->seq, seq + 2, memory_order_release);
+    }
+    traffic_hook_t *hook = &s_traffic_hooks[source];
+    hook->input = lwip_netif->input;
+    hook->linkoutput = lwip_netif->linkoutput;
+    hook->netif = lwip_netif;
+    lwip_netif->input = traffic_hook_input;
+    lwip_netif->linkoutput = traffic_hook_linkoutput;
+    return ESP_OK;
+#else
+    (void)ctx;
+    return ESP_OK;
+#endif
+}
+
+/**
+ * @brief Restores the original lwIP functions of a source (ctx) before its netif is
+ *        destroyed. Runs in the TCP/IP task.
+ */
+static esp_err_t traffic_hook_remove(void *ctx)
+{
+#if CONFIG_NET_MANAGER_TRAFFIC_HOOKS_ENABLED
+    net_event_source_t source = (net_event_source_t)(intptr_t)ctx;
+    traffic_hook_t *hook = &s_traffic_hooks[source];
+    struct netif *lwip_netif = esp_netif_get_netif_impl(netif_from_source(source));
+    if (!lwip_netif || lwip_netif != hook->netif)
+    {
+        // A stale entry must not match a new netif allocated at the same address.
+        hook->netif = NULL;
+        return ESP_ERR_INVALID_STATE;
+    }
+    lwip_netif->input = hook->input;
+    lwip_netif->linkoutput = hook->linkoutput;
+    hook->netif = NULL;
+    return ESP_OK;
+#else
+    (void)ctx;
+    return ESP_OK;
+#endif
+}
+
+/**
+ * @brief STA listen interval for a power-save policy, 0 keeps the driver default (3 beacons).
+ */
+static uint16_t ps_listen_interval(net_power_save_t policy)
+{
+    return (policy == NET_POWER_SAVE_LOW_POWER || policy == NET_POWER_SAVE_AUTO) ? CONFIG_NET_MANAGER_PS_LISTEN_INTERVAL : 0;
+}
+
+/**
+ * @brief Sets the driver power-save mode and the matching STA beacon timeout.
+ */
+static esp_err_t ps_set(wifi_ps_type_t type)
+{
+    esp_err_t err = esp_wifi_set_ps(type);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Failed to set power save mode %d (%s)", type, esp_err_to_name(err));
+        return err;
+    }
+    // A long listen interval skips beacons, so beacon loss must take longer to declare.
+    esp_wifi_set_inactive_time(WIFI_IF_STA, (type == WIFI_PS_MAX_MODEM) ? CONFIG_NET_MANAGER_PS_BEACON_TIMEOUT_S
+                                                                         : STA_BEACON_TIMEOUT_DEFAULT_S);
+    return ESP_OK;
+}
+
+/**
+ * @brief Idle check of AUTO mode, the switch itself runs in the worker.
+ */
+static void ps_idle_timer_cb(TimerHandle_t timer)
+{
+    uint32_t idle_ms = (uint32_t)(esp_timer_get_time() / 1000) - atomic_load_explicit(&s_sta_activity_ms, memory_order_relaxed);
+    if (!atomic_load_explicit(&s_ps_low_power, memory_order_relaxed) && idle_ms >= CONFIG_NET_MANAGER_PS_AUTO_IDLE_S * 1000U)
+        post_work(NET_WORK_PS_IDLE);
+}
+
+/**
+ * @brief Applies s_ps_policy to the running STA. AUTO starts in max performance.
+ *        Must be called with the lock held.
+ */
+static esp_err_t ps_apply(void)
+{
+    timer_release(&s_ps_idle_timer);
+    atomic_store_explicit(&s_ps_low_power, false, memory_order_relaxed);
+    if (!s_netif_sta)
+        return ESP_OK;
+
+    esp_err_t err;
+    switch (s_ps_policy)
+    {
+    case NET_POWER_SAVE_BALANCED:
+        err = ps_set(WIFI_PS_MIN_MODEM);
+        break;
+    case NET_POWER_SAVE_LOW_POWER:
+        err = ps_set(WIFI_PS_MAX_MODEM);
+        break;
+    default:
+        err = ps_set(WIFI_PS_NONE);
+        break;
+    }
+
+    if (err == ESP_OK && s_ps_policy == NET_POWER_SAVE_AUTO)
+    {
+        atomic_store_explicit(&s_sta_activity_ms, (uint32_t)(esp_timer_get_time() / 1000), memory_order_relaxed);
+        s_ps_idle_timer = timer_create(NM_TIMER_PS_IDLE, "nm_ps", pdMS_TO_TICKS(1000), pdTRUE, NULL, ps_idle_timer_cb);
+        if (s_ps_idle_timer)
+            xTimerStart(s_ps_idle_timer, 0);
+    }
+    return err;
+}
+
+/**
+ * @brief Moves AUTO mode to its idle (low power) or active (max performance) state.
+ *        Must be called with the lock held.
+ */
+static void ps_auto_switch(bool low_power)
+{
+    if (s_ps_policy != NET_POWER_SAVE_AUTO || !s_netif_sta)
+        return;
+
+    if (low_power)
+    {
+        // Traffic may have resumed since the timer posted the work.
+        uint32_t idle_ms = (uint32_t)(esp_timer_get_time() / 1000) - atomic_load_explicit(&s_sta_activity_ms, memory_order_relaxed);
+        if (atomic_load_explicit(&s_ps_low_power, memory_order_relaxed) || idle_ms < CONFIG_NET_MANAGER_PS_AUTO_IDLE_S * 1000U)
+            return;
+        // Set before the driver call so a frame sent meanwhile queues the wake-up behind it.
+        atomic_store_explicit(&s_ps_low_power, true, memory_order_relaxed);
+        if (ps_set(WIFI_PS_MAX_MODEM) != ESP_OK)
+            atomic_store_explicit(&s_ps_low_power, false, memory_order_relaxed);
+        else
+            ESP_LOGD(TAG, "Power save: STA idle, low power");
+    }
+    else if (!atomic_load_explicit(&s_ps_low_power, memory_order_relaxed))
+    {
+        ps_set(WIFI_PS_NONE);
+        ESP_LOGD(TAG, "Power save: STA traffic, max performance");
+    }
+}
+
+/**
+ * @brief Finds the RX task of the installed MAC driver by its name, NULL if unknown.
+ */
+static TaskHandle_t eth_rx_task_find(void)
+{
+    for (size_t i = 0; i < sizeof(s_eth_rx_task_names) / sizeof(s_eth_rx_task_names[0]); i++)
+    {
+        TaskHandle_t task = xTaskGetHandle(s_eth_rx_task_names[i]);
+        if (task)
+            return task;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Moves the RX task of the installed driver to the priority and core of eth_config.
+ *        ethernet_init creates the task from its own MAC config, so it is adjusted after
+ *        the install.
+ */
+static esp_err_t eth_rx_task_tune(const net_config_ethernet_t *eth_config)
+{
+    if ((eth_config->rx_task_priority == 0 && !eth_config->rx_task_pinned) || s_eth_handles_num == 0)
+        return ESP_OK;
+    // Tasks are found by name, which is ambiguous with several drivers of one kind
+    TaskHandle_t task = (s_eth_handles_num == 1) ? eth_rx_task_find() : NULL;
+    if (!task)
+    {
+        ESP_LOGE(TAG, "Ethernet RX task of this driver not found, can't tune it");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (eth_config->rx_task_priority != 0)
+        vTaskPrioritySet(task, eth_config->rx_task_priority);
+#if CONFIG_FREERTOS_SMP && configUSE_CORE_AFFINITY
+    if (eth_config->rx_task_pinned)
+        vTaskCoreAffinitySet(task, 1 << eth_config->rx_task_core);
+#endif
+    ESP_LOGI(TAG, "Ethernet RX task tuned: priority %u, core %s", eth_config->rx_task_priority,
+             eth_config->rx_task_pinned ? "pinned" : "any");
+    return ESP_OK;
+}
+
+/**
+ * @brief Installs the Ethernet driver with ethernet_init, then applies the RX task
+ *        settings of eth_config. Settings that can't be applied are refused before the
+ *        install, or undo it.
+ */
+static esp_err_t eth_driver_install(const net_config_ethernet_t *eth_config)
+{
+    if (eth_config->rx_task_stack_size != 0)
+    {
+        // The stack is allocated when ethernet_init creates the MAC, from its own config
+        ESP_LOGE(TAG, "rx_task_stack_size can't be applied to an ethernet_init driver");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (eth_config->rx_task_pinned)
+    {
+#if CONFIG_FREERTOS_SMP && configUSE_CORE_AFFINITY
+        if (eth_config->rx_task_core >= portNUM_PROCESSORS)
+            return ESP_ERR_INVALID_ARG;
+#else
+        // ESP-IDF FreeRTOS fixes the affinity when a task is created
+        ESP_LOGE(TAG, "rx_task_pinned needs CONFIG_FREERTOS_SMP");
+        return ESP_ERR_NOT_SUPPORTED;
+#endif
+    }
+
+    ESP_RETURN_ON_ERROR(ethernet_init_all(&s_eth_handles, &s_eth_handles_num), TAG, "ethernet_init_all() failed");
+    esp_err_t err = eth_rx_task_tune(eth_config);
+    if (err != ESP_OK)
+        eth_driver_uninstall();
+    return err;
+}
+
+/**
+ * @brief Releases the driver installed by eth_driver_install().
+ */
+static void eth_driver_uninstall(void)
+{
+    if (s_eth_handles)
+    {
+        ethernet_deinit_all(s_eth_handles);
+        s_eth_handles = NULL;
+        s_eth_handles_num = 0;
+    }
+}
+
+/**
+ * @brief Applies the driver tuning of eth_config to the first Ethernet interface.
+ *        Called before esp_eth_start().
+ */
+static void eth_tune(const net_config_ethernet_t *eth_config)
+{
+    if (eth_config->flow_control)
+    {
+        bool flow_control = true;
+        esp_err_t err = esp_eth_ioctl(s_eth_handles[0], ETH_CMD_S_FLOW_CTRL, &flow_control);
+        if (err != ESP_OK)
+            ESP_LOGW(TAG, "Failed to enable Ethernet flow control (%s)", esp_err_to_name(err));
+    }
+}
+
+#if CONFIG_NET_MANAGER_IPV6_ENABLED && LWIP_IPV6_DHCP6
+/**
+ * @brief Enables stateless DHCPv6 (DNS and other options next to SLAAC). Runs in the TCP/IP task.
+ */
+static esp_err_t ip6_enable_dhcp6(void *ctx)
+{
+    struct netif *lwip_netif = esp_netif_get_netif_impl((esp_netif_t *)ctx);
+    if (!lwip_netif)
+        return ESP_ERR_INVALID_STATE;
+    return dhcp6_enable_stateless(lwip_netif) == ERR_OK ? ESP_OK : ESP_FAIL;
+}
+#endif
+
+/**
+ * @brief Creates the link-local IPv6 address of an interface once its link is up.
+ *        Global addresses then follow from SLAAC (and stateless DHCPv6 if lwIP has it).
+ */
+static void ip6_start(esp_netif_t *netif)
+{
+#if CONFIG_NET_MANAGER_IPV6_ENABLED
+    if (!netif)
+        return;
+    esp_err_t err = esp_netif_create_ip6_linklocal(netif);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Failed to create IPv6 link-local address (%s)", esp_err_to_name(err));
+        return;
+    }
+#if LWIP_IPV6_DHCP6
+    esp_netif_tcpip_exec(ip6_enable_dhcp6, netif);
+#endif
+#else
+    (void)netif;
+#endif
+}
+
+/**
+ * @brief Rebuilds the IPv6 address list of an interface from its netif.
+ * @return true if the interface has a routable (global or unique local) address.
+ */
+static bool ip6_refresh_info(esp_netif_t *netif, net_ip6_info_t *info)
+{
+    bool routable = false;
+    memset(info, 0, sizeof(*info));
+#if CONFIG_NET_MANAGER_IPV6_ENABLED
+    esp_ip6_addr_t addrs[LWIP_IPV6_NUM_ADDRESSES];
+    int count = esp_netif_get_all_ip6(netif, addrs);
+    for (int i = 0; i < count && info->count < NET_MANAGER_IP6_ADDR_MAX; i++)
+    {
+        net_ip6_addr_t *entry = &info->addrs[info->count++];
+        entry->addr = addrs[i];
+        entry->type = esp_netif_ip6_get_addr_type(&addrs[i]);
+        if (entry->type == ESP_IP6_ADDR_IS_GLOBAL || entry->type == ESP_IP6_ADDR_IS_UNIQUE_LOCAL)
+            routable = true;
+    }
+#else
+    (void)netif;
+#endif
+    return routable;
+}
+
+/**
+ * @brief Handles IP_EVENT_GOT_IP6. Must be called with the lock held.
+ *        The first routable address makes an IPv6-only interface CONNECTED.
+ * @return true if event_to_dispatch was filled.
+ */
+static bool handle_got_ip6(const ip_event_got_ip6_t *event, net_manager_event_t *event_to_dispatch)
+{
+    iface_state_t iface;
+    if (!iface_from_netif(event->esp_netif, &iface))
+        return false;
+    net_event_source_t source = iface.source;
+    net_status_t *status = iface.status;
+    net_ip6_info_t *ip6_info = iface.ip6_info;
+    esp_netif_ip_info_t *ip_info = iface.ip_info;
+
+    ESP_LOGI(TAG, "Interface %d Got IPv6: " IPV6STR, source, IPV62STR(event->ip6_info.ip));
+    bool routable = ip6_refresh_info(event->esp_netif, ip6_info);
+
+    if (routable && *status != NET_STATUS_CONNECTED)
+    {
+        // IPv6-only network: the interface is usable without an IPv4 lease.
+        if (source == NET_EVENT_SOURCE_STA)
+            s_sta_retry_count = 0;
+        *status = NET_STATUS_CONNECTED;
+        dns_capture_servers(source);
+        if (s_user_callback)
+        {
+            net_manager_event_t ip6_event = {.source = source, .status = NET_STATUS_GOT_IP6, .data = (void *)&event->ip6_info};
+            s_user_callback(&ip6_event);
+        }
+        *event_to_dispatch = (net_manager_event_t){.source = source, .status = NET_STATUS_CONNECTED, .data = ip_info};
+        return true;
+    }
+
+    *event_to_dispatch = (net_manager_event_t){.source = source, .status = NET_STATUS_GOT_IP6, .data = (void *)&event->ip6_info};
+    return true;
+}
+
+#if 0
+/**
+ * @brief Helper to apply static IP configuration to a netif.
+ */
+static void apply_static_ip_config(esp_netif_t *netif, const esp_netif_ip_info_t *ip_info, const esp_ip4_addr_t *dns1, const esp_ip4_addr_t *dns2)
+{
+    // Stop the DHCP client first
+    ESP_ERROR_CHECK(esp_netif_dhcpc_stop(netif));
+
+    // Set static IP, netmask, gateway
+    ESP_ERROR_CHECK(esp_netif_set_ip_info(netif, ip_info));
+
+    // Set DNS servers
+    if (dns1 && dns1->addr != 0) {
+        esp_netif_dns_info_t dns_info_1 = {.ip.u_addr.ip4 = *dns1};
+        ESP_ERROR_CHECK(esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns_info_1));
+    }
+    if (dns2 && dns2->addr != 0) {
+        esp_netif_dns_info_t dns_info_2 = {.ip.u_addr.ip4 = *dns2};
+        ESP_ERROR_CHECK(esp_netif_set_dns_info(netif, ESP_NETIF_DNS_BACKUP, &dns_info_2));
+    }
+    ESP_LOGI(TAG, "Applied static IP settings for netif %p", netif);
+}
+#endif
+
+/*
+ * =====================================================================================
+ * |                                                                                   |
+ * |                                Public API Functions                               |
+ * |                                                                                   |
+ * =====================================================================================
+ */
+
+esp_err_t net_manager_init(net_event_callback_t cb)
+{
+    if (s_is_initialized)
+    {
+        ESP_LOGW(TAG, "Already initialized");
+        return ESP_OK;
+    }
+
+#if CONFIG_NET_MANAGER_STATIC_ALLOCATION
+    s_component_mutex = xSemaphoreCreateMutexStatic(&s_arena.mutex);
+#else
+    s_component_mutex = xSemaphoreCreateMutex();
+#endif
+    if (!s_component_mutex)
+    {
+        ESP_LOGE(TAG, "Failed to create mutex");
+        return ESP_FAIL;
+    }
+
+#if CONFIG_NET_MANAGER_STATIC_ALLOCATION
+    s_work_queue = xQueueCreateStatic(WORKER_QUEUE_LEN, sizeof(net_work_id_t), s_arena.work_queue_storage, &s_arena.work_queue);
+    s_work_exited = xSemaphoreCreateBinaryStatic(&s_arena.work_exited);
+    if (s_work_queue && s_work_exited)
+    {
+        s_work_task = xTaskCreateStatic(worker_task, "net_manager", CONFIG_NET_MANAGER_WORKER_STACK_SIZE, NULL,
+                                        CONFIG_NET_MANAGER_WORKER_PRIORITY, s_arena.work_stack, &s_arena.work_task);
+    }
+#else
+    s_work_queue = xQueueCreate(WORKER_QUEUE_LEN, sizeof(net_work_id_t));
+    s_work_exited = xSemaphoreCreateBinary();
+    if (s_work_queue && s_work_exited)
+        xTaskCreate(worker_task, "net_manager", CONFIG_NET_MANAGER_WORKER_STACK_SIZE, NULL, CONFIG_NET_MANAGER_WORKER_PRIORITY, &s_work_task);
+#endif
+    if (!s_work_queue || !s_work_exited || !s_work_task)
+    {
+        ESP_LOGE(TAG, "Failed to create worker task");
+        if (s_work_queue)
+            vQueueDelete(s_work_queue);
+        if (s_work_exited)
+            vSemaphoreDelete(s_work_exited);
+        vSemaphoreDelete(s_component_mutex);
+        s_work_queue = NULL;
+        s_work_exited = NULL;
+        s_component_mutex = NULL;
+        return ESP_FAIL;
+    }
+
+    LOCK();
+    memset(&s_status, 0, sizeof(net_manager_status_t));
+    memset(s_mem_phases, 0, sizeof(s_mem_phases));
+    s_user_callback = cb;
+
+    // NVS is read once here; later loads are served from s_config.
+    s_config_stored = (load_config(&s_config) == ESP_OK);
+    s_config_dirty = false;
+    s_config_commit_timer = timer_create(NM_TIMER_CONFIG_COMMIT, "nm_cfg", pdMS_TO_TICKS(CONFIG_NET_MANAGER_CONFIG_COMMIT_DELAY_MS), pdFALSE, NULL,
+                                         config_commit_timer_cb);
+
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &event_handler, NULL, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, ESP_EVENT_ANY_ID, &event_handler, NULL, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(ETH_EVENT, ESP_EVENT_ANY_ID, &event_handler, NULL, NULL));
+
+    s_is_initialized = true;
+    UNLOCK();
+
+    ESP_LOGI(TAG, "Initialized successfully");
+    return ESP_OK;
+}
+
+esp_err_t net_manager_deinit(void)
+{
+    if (!s_is_initialized)
+        return ESP_OK;
+
+    LOCK();
+    stop_all_interfaces();
+    timer_release(&s_config_commit_timer);
+    config_commit();
+    timer_release(&s_trial_timer); // A running trial stays recorded in NVS and resumes after the next init
+    s_trial_active = false;
+    esp_event_handler_instance_unregister(WIFI_EVENT, ESP_EVENT_ANY_ID, &event_handler);
+    esp_event_handler_instance_unregister(IP_EVENT, ESP_EVENT_ANY_ID, &event_handler);
+    esp_event_handler_instance_unregister(ETH_EVENT, ESP_EVENT_ANY_ID, &event_handler);
+    s_is_initialized = false;
+    UNLOCK();
+
+    // Blocks while the queue is full: a dropped EXIT would leave the wait below hanging.
+    net_work_id_t work = NET_WORK_EXIT;
+    xQueueSend(s_work_queue, &work, portMAX_DELAY);
+    xSemaphoreTake(s_work_exited, portMAX_DELAY);
+    vTaskDelete(s_work_task); // Suspended; deleted from here so a static TCB is free on return
+    vQueueDelete(s_work_queue);
+    vSemaphoreDelete(s_work_exited);
+    s_work_queue = NULL;
+    s_work_exited = NULL;
+    s_work_task = NULL;
+
+    vSemaphoreDelete(s_component_mutex);
+    s_component_mutex = NULL;
+    ESP_LOGI(TAG, "De-initialized successfully");
+    return ESP_OK;
+}
+
+esp_err_t net_manager_start(const net_manager_config_t *config)
+{
+    assert(s_is_initialized);
+    LOCK();
+
+    stop_all_interfaces(); // Ensure a clean state before starting
+
+    net_manager_config_t cfg;
+    if (config)
+    {
+        if (s_trial_active || s_trial_pending)
+        {
+            ESP_LOGW(TAG, "Explicit config given, abandoning the config trial");
+            config_trial_clear(false);
+        }
+        memcpy(&cfg, config, sizeof(net_manager_config_t));
+    }
+    else if (s_trial_pending)
+    {
+        memcpy(&cfg, &s_trial_config, sizeof(net_manager_config_t));
+        config_trial_arm();
+    }
+    else
+    {
+        if (s_config_stored)
+        {
+            memcpy(&cfg, &s_config, sizeof(net_manager_config_t));
+        }
+        else
+        {
+            ESP_LOGI(TAG, "No config in NVS, using factory or Kconfig defaults.");
+            get_default_config(&cfg);
+        }
+    }
+
+    esp_err_t err = start_interfaces(&cfg);
+    UNLOCK();
+    return err;
+}
+
+esp_err_t net_manager_apply_config(const net_manager_config_t *config)
+{
+    assert(s_is_initialized && config);
+    LOCK();
+    if (s_trial_active)
+    {
+        UNLOCK();
+        ESP_LOGE(TAG, "A config trial is already running");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // The trial slot is written synchronously, the trial must survive a restart.
+    uint8_t trial_slot = s_config_slot ^ 1;
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err == ESP_OK)
+    {
+        err = config_commit(); // Last-known-good must be in flash before it can be rolled back to
+        if (err == ESP_OK)
+            err = nvs_write_config(nvs_handle, trial_slot, config);
+        if (err == ESP_OK)
+            err = nvs_set_u8(nvs_handle, NVS_TRIAL_KEY, trial_slot);
+        if (err == ESP_OK)
+            err = nvs_commit(nvs_handle);
+        nvs_close(nvs_handle);
+    }
+    if (err != ESP_OK)
+    {
+        UNLOCK();
+        ESP_LOGE(TAG, "Failed to store the trial config (%s)", esp_err_to_name(err));
+        return err;
+    }
+
+    memcpy(&s_trial_config, config, sizeof(s_trial_config));
+    stop_all_interfaces();
+    config_trial_arm();
+    err = start_interfaces(&s_trial_config);
+    if (err != ESP_OK)
+    {
+        // A config that can't even start is rolled back now, not at the deadline.
+        ESP_LOGE(TAG, "Trial config failed to start, rolling back");
+        config_trial_end(false);
+        UNLOCK();
+        return err;
+    }
+    ESP_LOGI(TAG, "Config on trial in slot %d for up to %d s", trial_slot, CONFIG_NET_MANAGER_CONFIG_TRIAL_TIMEOUT_S);
+    UNLOCK();
+    return ESP_OK;
+}
+
+esp_err_t net_manager_stop(void)
+{
+    assert(s_is_initialized);
+    LOCK();
+    stop_all_interfaces();
+    UNLOCK();
+    return ESP_OK;
+}
+
+esp_err_t net_manager_get_status(net_manager_status_t *status)
+{
+    assert(s_is_initialized && status);
+    LOCK();
+    memcpy(status, &s_status, sizeof(net_manager_status_t));
+    if (s_netif_sta)
+        traffic_read(NET_EVENT_SOURCE_STA, &status->sta_traffic);
+    if (s_netif_ap)
+        traffic_read(NET_EVENT_SOURCE_AP, &status->ap_traffic);
+    if (s_netif_eth)
+        traffic_read(NET_EVENT_SOURCE_ETHERNET, &status->eth_traffic);
+    status->sta_rx_dropped = status->sta_traffic.rx_dropped;
+    status->eth_rx_dropped = status->eth_traffic.rx_dropped;
+    UNLOCK();
+    return ESP_OK;
+}
+
+bool net_manager_is_sta_connected(void)
+{
+    assert(s_is_initialized);
+    LOCK();
+    bool connected = (s_status.sta_status == NET_STATUS_CONNECTED);
+    UNLOCK();
+    return connected;
+}
+
+bool net_manager_is_eth_connected(void)
+{
+    assert(s_is_initialized);
+    LOCK();
+    bool connected = (s_status.eth_status == NET_STATUS_CONNECTED);
+    UNLOCK();
+    return connected;
+}
+
+esp_err_t net_manager_get_ap_clients_list(wifi_sta_list_t *clients)
+{
+    assert(s_is_initialized && clients);
+    if (!s_netif_ap)
+        return ESP_ERR_WIFI_NOT_STARTED;
+    return esp_wifi_ap_get_sta_list(clients);
+}
+
+esp_err_t net_manager_get_ap_clients(net_ap_client_t *clients, size_t max_clients, size_t *num_clients)
+{
+    assert(s_is_initialized && clients && num_clients);
+    unsigned seq_before, seq_after;
+    size_t count;
+    do
+    {
+        seq_before = atomic_load_explicit(&s_ap_clients_seq, memory_order_acquire);
+        count = 0;
+        for (int i = 0; i < CONFIG_NET_MANAGER_AP_CLIENT_TABLE_SIZE && count < max_clients; i++)
+        {
+            if (s_ap_clients[i].in_use)
+                ap_client_snapshot(&s_ap_clients[i], &clients[count++]);
+        }
+        atomic_thread_fence(memory_order_acquire);
+        seq_after = atomic_load_explicit(&s_ap_clients_seq, memory_order_relaxed);
+    } while ((seq_before & 1) || seq_before != seq_after);
+
+    *num_clients = count;
+    return ESP_OK;
+}
+
+esp_err_t net_manager_get_ap_client(const uint8_t mac[6], net_ap_client_t *client)
+{
+    assert(s_is_initialized && mac && client);
+    unsigned seq_before, seq_after;
+    int found;
+    do
+    {
+        seq_before = atomic_load_explicit(&s_ap_clients_seq, memory_order_acquire);
+        found = ap_client_find(mac);
+        if (found >= 0)
+            ap_client_snapshot(&s_ap_clients[found], client);
+        atomic_thread_fence(memory_order_acquire);
+        seq_after = atomic_load_explicit(&s_ap_clients_seq, memory_order_relaxed);
+    } while ((seq_before & 1) || seq_before != seq_after);
+
+    return (found >= 0) ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t net_manager_get_ap_leases(net_ap_lease_t *leases, size_t max_leases, size_t *num_leases)
+{
+    assert(s_is_initialized && leases && num_leases);
+    int64_t now = esp_timer_get_time();
+    size_t count = 0;
+    LOCK();
+    for (int i = 0; i < CONFIG_NET_MANAGER_AP_LEASE_TABLE_SIZE && count < max_leases; i++)
+    {
+        if (s_ap_leases[i].in_use && s_ap_leases[i].lease.expires_time_us > now)
+            leases[count++] = s_ap_leases[i].lease;
+    }
+    UNLOCK();
+    *num_leases = count;
+    return ESP_OK;
+}
+
+esp_err_t net_manager_get_ap_admission_stats(net_ap_admission_stats_t *stats)
+{
+    assert(s_is_initialized && stats);
+    LOCK();
+    *stats = s_ap_admission;
+    UNLOCK();
+    return ESP_OK;
+}
+
+esp_err_t net_manager_save_config_to_nvs(const net_manager_config_t *config)
+{
+    assert(s_is_initialized && config);
+    LOCK();
+    if (s_config_stored && memcmp(&s_config, config, sizeof(net_manager_config_t)) == 0)
+    {
+        UNLOCK();
+        return ESP_OK;
+    }
+    esp_err_t err = config_store(config);
+    UNLOCK();
+    return err;
+}
+
+esp_err_t net_manager_load_config_from_nvs(net_manager_config_t *config)
+{
+    assert(s_is_initialized && config);
+    LOCK();
+    bool stored = s_config_stored;
+    if (stored)
+        memcpy(config, &s_config, sizeof(net_manager_config_t));
+    UNLOCK();
+    return stored ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t net_manager_flush_config(void)
+{
+    assert(s_is_initialized);
+    LOCK();
+    if (s_config_commit_timer)
+        xTimerStop(s_config_commit_timer, 0);
+    esp_err_t err = config_commit();
+    UNLOCK();
+    return err;
+}
+
+esp_err_t net_manager_get_config_save_stats(net_config_save_stats_t *stats)
+{
+    assert(s_is_initialized && stats);
+    LOCK();
+    *stats = s_nvs_save_stats;
+    UNLOCK();
+    return ESP_OK;
+}
 
-        wifi_mode_t mode = WIFI_MODE_NULL;
-        if (cfg.wifi_sta_enabled && cfg.wifi_ap_enabled)
-            mode = WIFI_MODE_APSTA;
-        else if (cfg.wifi_sta_enabled)
-            mode = WIFI_MODE_STA;
-        else if (cfg.wifi_ap_enabled)
-            mode = WIFI_MODE_AP;
+esp_err_t net_manager_get_ip_info(net_event_source_t source, esp_netif_ip_info_t *ip_info)
+{
+    assert(s_is_initialized && ip_info);
+    esp_netif_t *netif = NULL;
+    if (source == NET_EVENT_SOURCE_STA)
+        netif = s_netif_sta;
+    else if (source == NET_EVENT_SOURCE_ETHERNET)
+        netif = s_netif_eth;
 
-        if (mode != WIFI_MODE_NULL)
+    if (!netif)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return esp_netif_get_ip_info(netif, ip_info);
+}
+
+esp_err_t net_manager_get_dns_info(net_event_source_t source, esp_netif_dns_type_t type, esp_netif_dns_info_t *dns_info)
+{
+    assert(s_is_initialized && dns_info);
+    esp_netif_t *netif = NULL;
+    if (source == NET_EVENT_SOURCE_STA)
+        netif = s_netif_sta;
+    else if (source == NET_EVENT_SOURCE_ETHERNET)
+        netif = s_netif_eth;
+
+    if (!netif)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return esp_netif_get_dns_info(netif, type, dns_info);
+}
+
+esp_err_t net_manager_bind_socket(int fd, const net_bind_policy_t *policy, net_event_source_t *bound_source)
+{
+    assert(s_is_initialized && policy);
+    if (fd < 0)
+        return ESP_ERR_INVALID_ARG;
+
+    LOCK();
+    net_event_source_t source;
+    esp_err_t err = resolve_bind_policy(policy, &source);
+    if (err != ESP_OK)
+    {
+        UNLOCK();
+        return err;
+    }
+
+    // Find the existing entry for this fd (rebind) or a free slot.
+    bound_socket_t *slot = NULL;
+    for (int i = 0; i < CONFIG_NET_MANAGER_MAX_BOUND_SOCKETS; i++)
+    {
+        if (s_bound_sockets[i].in_use && s_bound_sockets[i].fd == fd)
         {
-            ESP_ERROR_CHECK(esp_wifi_set_mode(mode));
+            slot = &s_bound_sockets[i];
+            break;
         }
+        if (!slot && !s_bound_sockets[i].in_use)
+            slot = &s_bound_sockets[i];
+    }
+    if (!slot)
+    {
+        UNLOCK();
+        ESP_LOGE(TAG, "Bound socket table full (%d entries)", CONFIG_NET_MANAGER_MAX_BOUND_SOCKETS);
+        return ESP_ERR_NO_MEM;
     }
 
-    if (cfg.wifi_sta_enabled)
-        start_sta(&cfg.wifi_sta_config);
-    if (cfg.wifi_ap_enabled)
-        start_ap(&cfg.wifi_ap_config);
-    if (cfg.ethernet_enabled)
-        start_eth(&cfg.ethernet_config);
+    struct ifreq ifr = {0};
+    err = esp_netif_get_netif_impl_name(netif_from_source(source), ifr.ifr_name);
+    if (err == ESP_OK && setsockopt(fd, SOL_SOCKET, SO_BINDTODEVICE, &ifr, sizeof(ifr)) != 0)
+    {
+        ESP_LOGE(TAG, "SO_BINDTODEVICE(%s) failed for socket %d, errno %d", ifr.ifr_name, fd, errno);
+        err = ESP_FAIL;
+    }
 
-    if (is_wifi_needed)
+    if (err == ESP_OK)
+    {
+        *slot = (bound_socket_t){.fd = fd, .source = source, .in_use = true};
+        if (bound_source)
+            *bound_source = source;
+        ESP_LOGI(TAG, "Socket %d bound to %s (interface %d)", fd, ifr.ifr_name, source);
+    }
+    UNLOCK();
+    return err;
+}
+
+esp_err_t net_manager_unbind_socket(int fd)
+{
+    assert(s_is_initialized);
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    LOCK();
+    for (int i = 0; i < CONFIG_NET_MANAGER_MAX_BOUND_SOCKETS; i++)
     {
-        ESP_ERROR_CHECK(esp_wifi_start());
+        if (s_bound_sockets[i].in_use && s_bound_sockets[i].fd == fd)
+        {
+            s_bound_sockets[i].in_use = false;
+            err = ESP_OK;
+            break;
+        }
     }
+    UNLOCK();
+    return err;
+}
 
+esp_err_t net_manager_report_rtt(net_event_source_t source, uint32_t rtt_ms)
+{
+    assert(s_is_initialized);
+    if (source >= NET_SOURCE_COUNT || rtt_ms == 0)
+        return ESP_ERR_INVALID_ARG;
+
+    LOCK();
+    rtt_update(source, rtt_ms);
     UNLOCK();
     return ESP_OK;
 }
 
-esp_err_t net_manager_stop(void)
+esp_err_t net_manager_get_rtt(net_event_source_t source, uint32_t *rtt_ms)
+{
+    assert(s_is_initialized && rtt_ms);
+    if (source >= NET_SOURCE_COUNT)
+        return ESP_ERR_INVALID_ARG;
+
+    LOCK();
+    *rtt_ms = s_rtt_ms[source];
+    UNLOCK();
+    return (*rtt_ms != 0) ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t net_manager_resolve(const char *hostname, esp_ip4_addr_t *addr)
+{
+    assert(s_is_initialized && hostname && addr);
+
+    // An address literal needs no server, it must not skew the statistics.
+    struct in_addr literal;
+    if (inet_aton(hostname, &literal))
+    {
+        addr->addr = literal.s_addr;
+        return ESP_OK;
+    }
+
+    LOCK();
+    dns_cache_entry_t *cached = dns_cache_find(hostname);
+    if (cached)
+    {
+        bool negative = cached->negative;
+        addr->addr = cached->addr.addr;
+        UNLOCK();
+        return negative ? ESP_ERR_NOT_FOUND : ESP_OK;
+    }
+    int source = dns_primary_source();
+    esp_ip4_addr_t main_addr = {0};
+    bool has_backup = false;
+    if (source >= 0)
+    {
+        main_addr = s_dns[source].servers[0].addr;
+        has_backup = s_dns[source].servers[1].addr.addr != 0;
+    }
+    UNLOCK();
+    if (main_addr.addr == 0)
+        return ESP_ERR_INVALID_STATE; // lwIP would fail at once, that is no answer
+
+    // The lookup itself runs without the lock, it can take several seconds.
+    struct addrinfo hints = {.ai_family = AF_INET, .ai_socktype = SOCK_STREAM};
+    struct addrinfo *result = NULL;
+    TickType_t start = xTaskGetTickCount();
+    int ret = getaddrinfo(hostname, NULL, &hints, &result);
+    uint32_t elapsed_ms = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+
+    // A failure before the last asked server ran out of resends is a negative answer.
+    uint32_t timeout_ms = has_backup ? 2 * DNS_SERVER_SWITCH_MS : DNS_SERVER_SWITCH_MS;
+    esp_err_t err;
+    LOCK();
+    if (ret == 0 && result)
+    {
+        addr->addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr.s_addr;
+        dns_record_lookup(main_addr, elapsed_ms, true);
+        dns_cache_store(hostname, addr, false);
+        err = ESP_OK;
+    }
+    else if (elapsed_ms < timeout_ms)
+    {
+        dns_record_lookup(main_addr, elapsed_ms, true);
+        dns_cache_store(hostname, NULL, true);
+        err = ESP_ERR_NOT_FOUND;
+    }
+    else
+    {
+        dns_record_lookup(main_addr, elapsed_ms, false);
+        err = ESP_ERR_TIMEOUT;
+    }
+    UNLOCK();
+
+    if (result)
+        freeaddrinfo(result);
+    return err;
+}
+
+esp_err_t net_manager_flush_dns_cache(void)
 {
     assert(s_is_initialized);
     LOCK();
-    stop_all_interfaces();
+    memset(s_dns_cache, 0, sizeof(s_dns_cache));
     UNLOCK();
     return ESP_OK;
 }
 
-esp_err_t net_manager_get_status(net_manager_status_t *status)
+esp_err_t net_manager_get_dns_stats(net_event_source_t source, net_dns_server_stats_t stats[2])
 {
-    assert(s_is_initialized && status);
+    assert(s_is_initialized && stats);
+    if (source != NET_EVENT_SOURCE_STA && source != NET_EVENT_SOURCE_ETHERNET)
+        return ESP_ERR_INVALID_ARG;
+
     LOCK();
-    memcpy(status, &s_status, sizeof(net_manager_status_t));
+    if (!netif_from_source(source))
+    {
+        UNLOCK();
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(stats, s_dns[source].servers, sizeof(s_dns[source].servers));
     UNLOCK();
     return ESP_OK;
 }
 
-bool net_manager_is_sta_connected(void)
+esp_err_t net_manager_ap_enable(void)
 {
     assert(s_is_initialized);
     LOCK();
-    bool connected = (s_status.sta_status == NET_STATUS_CONNECTED);
+    if (!s_ap_declared)
+    {
+        UNLOCK();
+        ESP_LOGE(TAG, "No AP declared in the active configuration");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_netif_ap)
+    {
+        // Already allocated; undo a provisioning policy suspension if any.
+        if (s_status.ap_suspended && wifi_set_mode(WIFI_MODE_APSTA) == ESP_OK)
+            s_status.ap_suspended = false;
+        UNLOCK();
+        return ESP_OK;
+    }
+
+    esp_err_t err = ap_runtime_start();
+    if (err == ESP_OK)
+        ESP_LOGI(TAG, "On-demand AP enabled");
     UNLOCK();
-    return connected;
+    return err;
 }
 
-bool net_manager_is_eth_connected(void)
+esp_err_t net_manager_ap_disable(void)
 {
     assert(s_is_initialized);
     LOCK();
-    bool connected = (s_status.eth_status == NET_STATUS_CONNECTED);
+    if (s_netif_ap)
+    {
+        ap_runtime_stop();
+        ESP_LOGI(TAG, "AP disabled, netif and DHCP server released");
+    }
     UNLOCK();
-    return connected;
+    return ESP_OK;
 }
 
-esp_err_t net_manager_get_ap_clients_list(wifi_sta_list_t *clients)
+esp_err_t net_manager_get_ap_roam_stats(net_ap_roam_stats_t *stats)
 {
-    assert(s_is_initialized && clients);
+    assert(s_is_initialized && stats);
+    LOCK();
     if (!s_netif_ap)
-        return ESP_ERR_WIFI_NOT_STARTED;
-    return esp_wifi_ap_get_sta_list(clients);
+    {
+        UNLOCK();
+        return ESP_ERR_INVALID_STATE;
+    }
+    *stats = s_ap_roam;
+    UNLOCK();
+    return ESP_OK;
 }
 
-esp_err_t net_manager_save_config_to_nvs(const net_manager_config_t *config)
+esp_err_t net_manager_save_profile(const char *name, const net_manager_config_t *config)
 {
-    assert(s_is_initialized && config);
+    assert(s_is_initialized && name && config);
+    size_t name_len = strlen(name);
+    if (name_len == 0 || name_len > NET_MANAGER_PROFILE_NAME_MAX)
+        return ESP_ERR_INVALID_ARG;
+
     nvs_handle_t nvs_handle;
     esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK)
+        return err;
+
+    LOCK();
+    profile_name_t index[CONFIG_NET_MANAGER_MAX_PROFILES];
+    err = profile_index_load(nvs_handle, index);
     if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "Error (%s) opening NVS handle!", esp_err_to_name(err));
+        UNLOCK();
+        nvs_close(nvs_handle);
         return err;
     }
-    err = nvs_set_blob(nvs_handle, NVS_CONFIG_KEY, config, sizeof(net_manager_config_t));
-    if (err == ESP_OK)
+    int slot = -1;
+    for (int i = 0; i < CONFIG_NET_MANAGER_MAX_PROFILES; i++)
+    {
+        if (strcmp(index[i], name) == 0)
+        {
+            slot = i;
+            break;
+        }
+        if (slot < 0 && index[i][0] == '\0')
+            slot = i;
+    }
+
+    char key[NVS_KEY_LEN];
+    size_t len = nm_config_encode(config, s_config_buf, sizeof(s_config_buf));
+    if (slot < 0)
+        err = ESP_ERR_NO_MEM;
+    else if (len == 0)
+        err = ESP_ERR_INVALID_SIZE;
+    else
+        err = nvs_set_blob(nvs_handle, profile_key(key, name), s_config_buf, len);
+    if (err == ESP_OK && strcmp(index[slot], name) != 0)
     {
+        strncpy(index[slot], name, NET_MANAGER_PROFILE_NAME_MAX);
+        err = nvs_set_blob(nvs_handle, NVS_PROFILE_INDEX_KEY, index, sizeof(index));
+    }
+    if (err == ESP_OK)
         err = nvs_commit(nvs_handle);
+    UNLOCK();
+    nvs_close(nvs_handle);
+
+    ESP_LOGI(TAG, "Profile '%s' saved %s (%u bytes)", name, (err == ESP_OK) ? "successfully" : "failed", (unsigned)len);
+    return err;
+}
+
+esp_err_t net_manager_delete_profile(const char *name)
+{
+    assert(s_is_initialized && name);
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK)
+        return err;
+
+    LOCK();
+    profile_name_t index[CONFIG_NET_MANAGER_MAX_PROFILES];
+    err = profile_index_load(nvs_handle, index);
+    if (err == ESP_OK)
+        err = ESP_ERR_NOT_FOUND;
+    for (int i = 0; err == ESP_ERR_NOT_FOUND && i < CONFIG_NET_MANAGER_MAX_PROFILES; i++)
+    {
+        if (strcmp(index[i], name) == 0)
+        {
+            char key[NVS_KEY_LEN];
+            memset(index[i], 0, sizeof(index[i]));
+            nvs_erase_key(nvs_handle, profile_key(key, name));
+            err = nvs_set_blob(nvs_handle, NVS_PROFILE_INDEX_KEY, index, sizeof(index));
+            if (err == ESP_OK)
+                err = nvs_commit(nvs_handle);
+            break;
+        }
     }
+    UNLOCK();
     nvs_close(nvs_handle);
-    ESP_LOGI(TAG, "Configuration saved to NVS %s", (err == ESP_OK) ? "successfully" : "failed");
     return err;
 }
 
-esp_err_t net_manager_load_config_from_nvs(net_manager_config_t *config)
+esp_err_t net_manager_activate_profile(const char *name)
 {
-    assert(s_is_initialized && config);
+    assert(s_is_initialized && name);
+    int64_t start_us = esp_timer_get_time();
     nvs_handle_t nvs_handle;
     esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
     if (err != ESP_OK)
         return err;
 
-    size_t required_size = sizeof(net_manager_config_t);
-    err = nvs_get_blob(nvs_handle, NVS_CONFIG_KEY, config, &required_size);
+    LOCK();
+    char key[NVS_KEY_LEN];
+    size_t len = sizeof(s_config_buf);
+    err = nvs_get_blob(nvs_handle, profile_key(key, name), s_config_buf, &len);
     nvs_close(nvs_handle);
+    if (err != ESP_OK)
+    {
+        UNLOCK();
+        ESP_LOGE(TAG, "Profile '%s' not found", name);
+        return (err == ESP_ERR_NVS_NOT_FOUND) ? ESP_ERR_NOT_FOUND : err;
+    }
+    if (s_trial_active)
+    {
+        UNLOCK();
+        ESP_LOGE(TAG, "A config trial is running");
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    if (err == ESP_OK && required_size != sizeof(net_manager_config_t))
+    net_manager_config_t cfg;
+    get_default_config(&cfg);
+    nm_config_decode(s_config_buf, len, &cfg);
+    err = switch_interfaces(&cfg);
+    if (err == ESP_OK)
+        config_store(&cfg); // The active profile is what net_manager_start(NULL) brings up next boot
+    UNLOCK();
+    if (err != ESP_OK)
     {
-        ESP_LOGW(TAG, "NVS config size mismatch. Expected %d, got %d.", sizeof(net_manager_config_t), required_size);
-        return ESP_FAIL;
+        ESP_LOGE(TAG, "Profile '%s' failed to start (%s)", name, esp_err_to_name(err));
+        return err;
     }
 
-    ESP_LOGI(TAG, "Configuration loaded from NVS %s", (err == ESP_OK) ? "successfully" : "failed (or not found)");
-    return err;
+    ESP_LOGI(TAG, "Profile '%s' active in %lu ms", name, (unsigned long)((esp_timer_get_time() - start_us) / 1000));
+    return ESP_OK;
 }
 
-esp_err_t net_manager_get_ip_info(net_event_source_t source, esp_netif_ip_info_t *ip_info)
+esp_err_t net_manager_get_memory_report(net_memory_report_t *report)
 {
-    assert(s_is_initialized && ip_info);
-    esp_netif_t *netif = NULL;
-    if (source == NET_EVENT_SOURCE_STA)
-        netif = s_netif_sta;
-    else if (source == NET_EVENT_SOURCE_ETHERNET)
-        netif = s_netif_eth;
+    assert(s_is_initialized && report);
+    mem_sample_t now;
+    mem_sample(&now);
 
-    if (!netif)
-    {
+    LOCK();
+    memcpy(report->phases, s_mem_phases, sizeof(report->phases));
+    UNLOCK();
+    report->internal_free = now.internal_free;
+    report->internal_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    report->internal_largest_block = now.internal_largest;
+    report->spiram_free = now.spiram_free;
+    report->spiram_largest_block = now.spiram_largest;
+    report->static_bytes = sizeof(s_bound_sockets) + sizeof(s_dns) + sizeof(s_dns_cache) + sizeof(s_ap_clients) +
+                           sizeof(s_ap_leases) + sizeof(s_ap_roam_lost) + sizeof(s_nvs_config) + sizeof(s_config) +
+                           sizeof(s_trial_config) + sizeof(s_running_config) + sizeof(s_config_buf);
+#if CONFIG_NET_MANAGER_STATIC_ALLOCATION
+    report->static_bytes += sizeof(s_arena);
+#endif
+    report->worker_stack_free_min = uxTaskGetStackHighWaterMark(s_work_task);
+    report->work_queue_peak = (uint8_t)atomic_load_explicit(&s_work_queue_peak, memory_order_relaxed);
+    return ESP_OK;
+}
+
+esp_err_t net_manager_set_power_save(net_power_save_t policy)
+{
+    assert(s_is_initialized);
+    if (policy > NET_POWER_SAVE_AUTO)
         return ESP_ERR_INVALID_ARG;
+#if !CONFIG_NET_MANAGER_TRAFFIC_HOOKS_ENABLED
+    if (policy == NET_POWER_SAVE_AUTO)
+        return ESP_ERR_NOT_SUPPORTED; // Wakes on the STA traffic seen by the hooks
+#endif
+
+    LOCK();
+    net_power_save_t old_policy = s_ps_policy;
+    s_ps_policy = policy;
+    esp_err_t err = ps_apply();
+    if (err != ESP_OK)
+    {
+        s_ps_policy = old_policy;
+        ps_apply();
     }
-    return esp_netif_get_ip_info(netif, ip_info);
+    else if (s_netif_sta && ps_listen_interval(policy) != ps_listen_interval(old_policy))
+    {
+        // Stored for the next association; the current AP keeps the old interval.
+        wifi_config_t wifi_cfg;
+        if (esp_wifi_get_config(ESP_IF_WIFI_STA, &wifi_cfg) == ESP_OK)
+        {
+            wifi_cfg.sta.listen_interval = ps_listen_interval(policy);
+            esp_wifi_set_config(ESP_IF_WIFI_STA, &wifi_cfg);
+        }
+    }
+    UNLOCK();
+
+    if (err == ESP_OK)
+        ESP_LOGI(TAG, "Power save policy set to %d", policy);
+    return err;
 }
 
-esp_err_t net_manager_get_dns_info(net_event_source_t source, esp_netif_dns_type_t type, esp_netif_dns_info_t *dns_info)
+esp_err_t net_manager_get_power_save(net_power_save_t *policy, bool *low_power)
 {
-    assert(s_is_initialized && dns_info);
-    esp_netif_t *netif = NULL;
-    if (source == NET_EVENT_SOURCE_STA)
-        netif = s_netif_sta;
-    else if (source == NET_EVENT_SOURCE_ETHERNET)
-        netif = s_netif_eth;
-
-    if (!netif)
+    assert(s_is_initialized && policy);
+    LOCK();
+    *policy = s_ps_policy;
+    if (low_power)
     {
-        return ESP_ERR_INVALID_ARG;
+        *low_power = (s_ps_policy == NET_POWER_SAVE_LOW_POWER) ||
+                     (s_ps_policy == NET_POWER_SAVE_AUTO && atomic_load_explicit(&s_ps_low_power, memory_order_relaxed));
     }
-    return esp_netif_get_dns_info(netif, type, dns_info);
-}
\ No newline at end of file
+    UNLOCK();
+    return ESP_OK;
+}
@@ -0,0 +1,96 @@
+#ifndef NET_MANAGER_BENCH_H
+#define NET_MANAGER_BENCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_netif_ip_addr.h"
+#include "sdkconfig.h"
+#if CONFIG_IDF_TARGET_LINUX
+typedef int net_event_source_t; // No net_manager on the host, runs there are unbound
+#else
+#include "net_manager.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NET_BENCH_DEFAULT_PORT 5001
+#define NET_BENCH_MAX_BUFFER_SIZE 16384
+#define NET_BENCH_WAIT_MS 30000 // How long a server waits for its client
+#define NET_BENCH_MAX_CORES 2
+#define NET_BENCH_CPU_UNKNOWN 0xFF // Needs CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+
+/**
+ * @brief Benchmark transport
+ */
+typedef enum {
+    NET_BENCH_TCP,
+    NET_BENCH_UDP,
+} net_bench_proto_t;
+
+/**
+ * @brief Benchmark role. The client sends, the server receives.
+ */
+typedef enum {
+    NET_BENCH_CLIENT,
+    NET_BENCH_SERVER,
+} net_bench_role_t;
+
+/**
+ * @brief Benchmark run configuration
+ */
+typedef struct {
+    net_bench_proto_t proto;
+    net_bench_role_t role;
+    bool bind_source;          // Bind to the netif of source; false uses the routing table (loopback runs)
+    net_event_source_t source;
+    esp_ip4_addr_t remote;     // Client only: server address
+    uint16_t port;             // 0 = NET_BENCH_DEFAULT_PORT
+    uint32_t duration_s;       // Client: send time; server: longest receive time
+    uint16_t buffer_size;      // Bytes per send/datagram, 0 = 1460 (TCP) or 1470 (UDP)
+    uint32_t udp_rate_kbps;    // UDP client send rate, 0 = as fast as possible
+} net_bench_config_t;
+
+/**
+ * @brief Benchmark result
+ */
+typedef struct {
+    uint64_t bytes;            // Payload bytes sent (client) or received (server)
+    uint32_t duration_ms;      // From the first to the last byte
+    uint32_t throughput_kbps;
+
+    // --- UDP server only ---
+    uint32_t packets;          // Datagrams received
+    uint32_t lost;             // Sequence numbers never received
+    uint32_t out_of_order;
+    uint32_t jitter_us;        // Interarrival jitter (RFC 3550)
+
+    uint8_t cpu_load_pct[NET_BENCH_MAX_CORES]; // Per core during the run, NET_BENCH_CPU_UNKNOWN if not measured
+} net_bench_result_t;
+
+/**
+ * @brief Runs one benchmark in the calling task and blocks until it ends.
+ *        A server handles a single client, waiting up to NET_BENCH_WAIT_MS for it; it
+ *        stops when the client closes (TCP) or sends its end marker (UDP), or after
+ *        duration_s. With bind_source, the socket is bound through net_manager_bind_socket().
+ *
+ * @param config Run configuration.
+ * @param[out] result Filled with the result.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_TIMEOUT if no client showed up,
+ *         ESP_ERR_INVALID_STATE if a benchmark is already running,
+ *         ESP_ERR_NOT_SUPPORTED for bind_source on the linux target.
+ */
+esp_err_t net_manager_bench_run(const net_bench_config_t *config, net_bench_result_t *result);
+
+/**
+ * @brief Ends a running benchmark early; net_manager_bench_run() returns its result so far.
+ */
+void net_manager_bench_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NET_MANAGER_BENCH_H
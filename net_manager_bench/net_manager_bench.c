@@ -0,0 +1,448 @@
+/**
+ * @file net_manager_bench.c
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "lwip/sockets.h"
+
+#include "net_manager_bench.h"
+
+/* --- Macros and Definitions --- */
+static const char *TAG = "NET_BENCH";
+#define BENCH_TCP_BUFFER_SIZE 1460
+#define BENCH_UDP_BUFFER_SIZE 1470    // Largest datagram that fits a 1500-byte MTU
+#define BENCH_DEFAULT_DURATION_S 10
+#define BENCH_POLL_MS 100             // Socket timeout, bounds the reaction to net_manager_bench_stop()
+#define BENCH_UDP_FIN 0x80000000u     // Sequence number flag of the end markers
+#define BENCH_UDP_FIN_COUNT 3         // End markers sent, in case some are lost
+
+// Starts every UDP datagram, network byte order
+typedef struct {
+    uint32_t seq;
+    uint32_t time_hi; // esp_timer time of sending, in us
+    uint32_t time_lo;
+} bench_udp_hdr_t;
+
+// FreeRTOS run-time counters, see cpu_sample()
+typedef struct {
+    uint32_t total;
+    uint32_t idle[NET_BENCH_MAX_CORES];
+} cpu_sample_t;
+
+static atomic_bool s_bench_running;
+static atomic_bool s_bench_stop;
+
+/**
+ * @brief Samples the run-time counter and the idle task counter of each core.
+ *        The counters are 32-bit and wrap, only differences are meaningful.
+ */
+static void cpu_sample(cpu_sample_t *sample)
+{
+    memset(sample, 0, sizeof(*sample));
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    sample->total = (uint32_t)portGET_RUN_TIME_COUNTER_VALUE();
+    for (int core = 0; core < portNUM_PROCESSORS && core < NET_BENCH_MAX_CORES; core++)
+        sample->idle[core] = (uint32_t)ulTaskGetRunTimeCounter(xTaskGetIdleTaskHandleForCore(core));
+#endif
+}
+
+/**
+ * @brief Fills the per-core CPU load of result from the time not spent in the idle tasks.
+ */
+static void cpu_load(const cpu_sample_t *before, net_bench_result_t *result)
+{
+    memset(result->cpu_load_pct, NET_BENCH_CPU_UNKNOWN, sizeof(result->cpu_load_pct));
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    cpu_sample_t after;
+    cpu_sample(&after);
+    uint32_t total = after.total - before->total;
+    if (total == 0)
+        return;
+    for (int core = 0; core < portNUM_PROCESSORS && core < NET_BENCH_MAX_CORES; core++)
+    {
+        uint32_t idle = after.idle[core] - before->idle[core];
+        result->cpu_load_pct[core] = (idle >= total) ? 0 : (uint8_t)(100 - (uint64_t)idle * 100 / total);
+    }
+#else
+    (void)before;
+#endif
+}
+
+/**
+ * @brief Sets the receive and send timeouts of a socket.
+ */
+static void set_timeouts(int fd, uint32_t ms)
+{
+    struct timeval tv = {.tv_sec = ms / 1000, .tv_usec = (ms % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+/**
+ * @brief Creates the benchmark socket, bound to the netif of config->source if requested.
+ * @return The socket, or -1 on failure.
+ */
+static int bench_socket(const net_bench_config_t *config)
+{
+    bool tcp = (config->proto == NET_BENCH_TCP);
+    int fd = socket(AF_INET, tcp ? SOCK_STREAM : SOCK_DGRAM, tcp ? IPPROTO_TCP : IPPROTO_UDP);
+    if (fd < 0)
+    {
+        ESP_LOGE(TAG, "Failed to create socket, errno %d", errno);
+        return -1;
+    }
+#if !CONFIG_IDF_TARGET_LINUX
+    if (config->bind_source)
+    {
+        net_bind_policy_t policy = {.type = NET_BIND_POLICY_SPECIFIC_SOURCE, .source = config->source};
+        if (net_manager_bind_socket(fd, &policy, NULL) != ESP_OK)
+        {
+            close(fd);
+            return -1;
+        }
+    }
+#endif
+    set_timeouts(fd, BENCH_POLL_MS);
+    return fd;
+}
+
+/**
+ * @brief Closes a socket made by bench_socket().
+ */
+static void bench_close(const net_bench_config_t *config, int fd)
+{
+#if !CONFIG_IDF_TARGET_LINUX
+    if (config->bind_source)
+        net_manager_unbind_socket(fd);
+#endif
+    close(fd);
+}
+
+/**
+ * @brief Binds a server socket to the benchmark port on all addresses.
+ */
+static esp_err_t bench_listen_addr(int fd, const net_bench_config_t *config)
+{
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(config->port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        ESP_LOGE(TAG, "Failed to bind port %u, errno %d", config->port, errno);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief TCP client: sends for duration_s.
+ */
+static esp_err_t tcp_client(int fd, const net_bench_config_t *config, uint8_t *buf, net_bench_result_t *result)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(config->port),
+        .sin_addr.s_addr = config->remote.addr,
+    };
+    set_timeouts(fd, NET_BENCH_WAIT_MS);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        ESP_LOGE(TAG, "Failed to connect to " IPSTR ":%u, errno %d", IP2STR(&config->remote), config->port, errno);
+        return ESP_FAIL;
+    }
+    set_timeouts(fd, BENCH_POLL_MS);
+
+    int64_t start_us = esp_timer_get_time();
+    int64_t end_us = start_us + (int64_t)config->duration_s * 1000000;
+    int64_t now_us = start_us;
+    while (!atomic_load(&s_bench_stop) && now_us < end_us)
+    {
+        int sent = send(fd, buf, config->buffer_size, 0);
+        now_us = esp_timer_get_time();
+        if (sent > 0)
+            result->bytes += sent;
+        else if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            ESP_LOGW(TAG, "send() failed, errno %d", errno);
+            break;
+        }
+    }
+    result->duration_ms = (uint32_t)((now_us - start_us) / 1000);
+    return ESP_OK;
+}
+
+/**
+ * @brief Waits up to NET_BENCH_WAIT_MS for a socket to become readable.
+ */
+static esp_err_t wait_readable(int fd)
+{
+    for (int waited = 0; waited < NET_BENCH_WAIT_MS && !atomic_load(&s_bench_stop); waited += BENCH_POLL_MS)
+    {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(fd, &readable);
+        struct timeval tv = {.tv_sec = 0, .tv_usec = BENCH_POLL_MS * 1000};
+        if (select(fd + 1, &readable, NULL, NULL, &tv) > 0)
+            return ESP_OK;
+    }
+    return ESP_ERR_TIMEOUT;
+}
+
+/**
+ * @brief TCP server: receives from one client until it closes or duration_s has passed.
+ */
+static esp_err_t tcp_server(int fd, const net_bench_config_t *config, uint8_t *buf, net_bench_result_t *result)
+{
+    if (bench_listen_addr(fd, config) != ESP_OK || listen(fd, 1) != 0)
+        return ESP_FAIL;
+    ESP_LOGI(TAG, "TCP server listening on port %u", config->port);
+    esp_err_t err = wait_readable(fd);
+    if (err != ESP_OK)
+        return err;
+    int conn = accept(fd, NULL, NULL);
+    if (conn < 0)
+    {
+        ESP_LOGE(TAG, "accept() failed, errno %d", errno);
+        return ESP_FAIL;
+    }
+    set_timeouts(conn, BENCH_POLL_MS);
+
+    int64_t start_us = 0;
+    int64_t last_us = 0;
+    int64_t end_us = INT64_MAX;
+    while (!atomic_load(&s_bench_stop) && esp_timer_get_time() < end_us)
+    {
+        int received = recv(conn, buf, config->buffer_size, 0);
+        if (received == 0)
+            break; // Client done
+        if (received < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                continue;
+            ESP_LOGW(TAG, "recv() failed, errno %d", errno);
+            break;
+        }
+        last_us = esp_timer_get_time();
+        if (start_us == 0)
+        {
+            start_us = last_us;
+            end_us = start_us + (int64_t)config->duration_s * 1000000;
+        }
+        result->bytes += received;
+    }
+    close(conn);
+    result->duration_ms = (uint32_t)((last_us - start_us) / 1000);
+    return ESP_OK;
+}
+
+/**
+ * @brief UDP client: sends numbered, timestamped datagrams at udp_rate_kbps for
+ *        duration_s, then the end markers.
+ */
+static esp_err_t udp_client(int fd, const net_bench_config_t *config, uint8_t *buf, net_bench_result_t *result)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(config->port),
+        .sin_addr.s_addr = config->remote.addr,
+    };
+    int64_t interval_us = config->udp_rate_kbps ? (int64_t)config->buffer_size * 8000 / config->udp_rate_kbps : 0;
+    bench_udp_hdr_t hdr;
+    uint32_t seq = 0;
+
+    int64_t start_us = esp_timer_get_time();
+    int64_t end_us = start_us + (int64_t)config->duration_s * 1000000;
+    int64_t next_us = start_us;
+    int64_t now_us = start_us;
+    while (!atomic_load(&s_bench_stop) && now_us < end_us)
+    {
+        if (next_us - now_us >= portTICK_PERIOD_MS * 1000)
+            vTaskDelay((next_us - now_us) / 1000 / portTICK_PERIOD_MS);
+        now_us = esp_timer_get_time();
+        hdr.seq = htonl(seq);
+        hdr.time_hi = htonl((uint32_t)(now_us >> 32));
+        hdr.time_lo = htonl((uint32_t)now_us);
+        memcpy(buf, &hdr, sizeof(hdr));
+        int sent = sendto(fd, buf, config->buffer_size, 0, (struct sockaddr *)&addr, sizeof(addr));
+        if (sent > 0)
+        {
+            result->bytes += sent;
+            result->packets++;
+            seq++;
+            next_us += interval_us;
+        }
+        else if (errno == ENOMEM)
+            vTaskDelay(1); // lwIP out of buffers, let the driver drain
+        else
+        {
+            ESP_LOGW(TAG, "sendto() failed, errno %d", errno);
+            break;
+        }
+    }
+    result->duration_ms = (uint32_t)((now_us - start_us) / 1000);
+
+    hdr.seq = htonl(seq | BENCH_UDP_FIN);
+    memcpy(buf, &hdr, sizeof(hdr));
+    for (int i = 0; i < BENCH_UDP_FIN_COUNT; i++)
+    {
+        sendto(fd, buf, sizeof(hdr), 0, (struct sockaddr *)&addr, sizeof(addr));
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief UDP server: receives until the client's end marker or duration_s has passed,
+ *        counting lost and reordered datagrams and the interarrival jitter.
+ */
+static esp_err_t udp_server(int fd, const net_bench_config_t *config, uint8_t *buf, net_bench_result_t *result)
+{
+    if (bench_listen_addr(fd, config) != ESP_OK)
+        return ESP_FAIL;
+    ESP_LOGI(TAG, "UDP server listening on port %u", config->port);
+    esp_err_t err = wait_readable(fd);
+    if (err != ESP_OK)
+        return err;
+
+    uint32_t expected = 0;
+    int64_t prev_transit = 0;
+    int64_t jitter = 0; // RFC 3550: 16 times the estimate
+    int64_t start_us = 0;
+    int64_t last_us = 0;
+    int64_t end_us = INT64_MAX;
+    while (!atomic_load(&s_bench_stop) && esp_timer_get_time() < end_us)
+    {
+        int received = recv(fd, buf, config->buffer_size, 0);
+        if (received < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                continue;
+            ESP_LOGW(TAG, "recv() failed, errno %d", errno);
+            break;
+        }
+        if (received < (int)sizeof(bench_udp_hdr_t))
+            continue;
+
+        int64_t now_us = esp_timer_get_time();
+        bench_udp_hdr_t hdr;
+        memcpy(&hdr, buf, sizeof(hdr));
+        uint32_t seq = ntohl(hdr.seq);
+        if (seq & BENCH_UDP_FIN)
+        {
+            if (start_us != 0)
+                break;
+            continue; // End marker of an earlier run
+        }
+        if (start_us == 0)
+        {
+            start_us = now_us;
+            end_us = start_us + (int64_t)config->duration_s * 1000000;
+        }
+        last_us = now_us;
+        result->bytes += received;
+        result->packets++;
+
+        // Sender and receiver clocks differ by a constant, which cancels out in D.
+        int64_t sent_us = ((int64_t)ntohl(hdr.time_hi) << 32) | ntohl(hdr.time_lo);
+        int64_t transit = now_us - sent_us;
+        if (result->packets > 1)
+        {
+            int64_t d = transit - prev_transit;
+            jitter += ((d < 0) ? -d : d) - ((jitter + 8) >> 4);
+        }
+        prev_transit = transit;
+
+        if (seq >= expected)
+        {
+            result->lost += seq - expected;
+            expected = seq + 1;
+        }
+        else
+        {
+            result->out_of_order++;
+            if (result->lost > 0)
+                result->lost--;
+        }
+    }
+    result->duration_ms = (uint32_t)((last_us - start_us) / 1000);
+    result->jitter_us = (uint32_t)(jitter >> 4);
+    return ESP_OK;
+}
+
+esp_err_t net_manager_bench_run(const net_bench_config_t *config, net_bench_result_t *result)
+{
+    assert(config && result);
+    bool udp = (config->proto == NET_BENCH_UDP);
+    if (config->buffer_size > NET_BENCH_MAX_BUFFER_SIZE || (udp && config->buffer_size != 0 && config->buffer_size < sizeof(bench_udp_hdr_t)) ||
+        (config->role == NET_BENCH_CLIENT && config->remote.addr == 0))
+        return ESP_ERR_INVALID_ARG;
+#if CONFIG_IDF_TARGET_LINUX
+    if (config->bind_source)
+        return ESP_ERR_NOT_SUPPORTED;
+#endif
+    if (atomic_exchange(&s_bench_running, true))
+        return ESP_ERR_INVALID_STATE;
+    atomic_store(&s_bench_stop, false);
+
+    net_bench_config_t cfg = *config;
+    if (cfg.port == 0)
+        cfg.port = NET_BENCH_DEFAULT_PORT;
+    if (cfg.duration_s == 0)
+        cfg.duration_s = BENCH_DEFAULT_DURATION_S;
+    if (cfg.buffer_size == 0)
+        cfg.buffer_size = udp ? BENCH_UDP_BUFFER_SIZE : BENCH_TCP_BUFFER_SIZE;
+    memset(result, 0, sizeof(*result));
+
+    esp_err_t err = ESP_ERR_NO_MEM;
+    uint8_t *buf = malloc(cfg.buffer_size);
+    int fd = buf ? bench_socket(&cfg) : -1;
+    if (fd >= 0)
+    {
+        for (size_t i = 0; i < cfg.buffer_size; i++)
+            buf[i] = (uint8_t)i;
+        cpu_sample_t cpu;
+        cpu_sample(&cpu);
+        if (cfg.role == NET_BENCH_CLIENT)
+            err = udp ? udp_client(fd, &cfg, buf, result) : tcp_client(fd, &cfg, buf, result);
+        else
+            err = udp ? udp_server(fd, &cfg, buf, result) : tcp_server(fd, &cfg, buf, result);
+        cpu_load(&cpu, result);
+        bench_close(&cfg, fd);
+    }
+    else if (buf)
+        err = ESP_FAIL;
+    free(buf);
+
+    if (result->duration_ms > 0)
+        result->throughput_kbps = (uint32_t)(result->bytes * 8 / result->duration_ms);
+    if (err == ESP_OK)
+    {
+        ESP_LOGI(TAG, "%s %s: %llu bytes in %lu ms, %lu kbit/s", udp ? "UDP" : "TCP",
+                 cfg.role == NET_BENCH_CLIENT ? "client" : "server", (unsigned long long)result->bytes,
+                 (unsigned long)result->duration_ms, (unsigned long)result->throughput_kbps);
+        if (result->cpu_load_pct[0] != NET_BENCH_CPU_UNKNOWN)
+            ESP_LOGI(TAG, "CPU load: core 0 %u%%, core 1 %u%%", result->cpu_load_pct[0], result->cpu_load_pct[1]);
+        if (udp && cfg.role == NET_BENCH_SERVER)
+            ESP_LOGI(TAG, "UDP: %lu datagrams, %lu lost, %lu out of order, jitter %lu us", (unsigned long)result->packets,
+                     (unsigned long)result->lost, (unsigned long)result->out_of_order, (unsigned long)result->jitter_us);
+    }
+    atomic_store(&s_bench_running, false);
+    return err;
+}
+
+void net_manager_bench_stop(void)
+{
+    atomic_store(&s_bench_stop, true);
+}
@@ -0,0 +1,282 @@
+/**
+ * @file test_bench_loopback.c
+ *
+ * Runs every net_manager_bench mode over loopback against a minimal peer task and checks
+ * the counts. Built for the linux target, so data-path regressions show up without hardware.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include "lwip/sockets.h"
+
+#include "net_manager_bench.h"
+
+static const char *TAG = "BENCH_TEST";
+#define TEST_PORT 5002
+#define TEST_DURATION_S 1
+#define TEST_TCP_BYTES (64 * 1024)
+#define TEST_UDP_DATAGRAMS 100
+#define TEST_UDP_SKIPPED_SEQ 50   // Never sent, the server must count it lost
+#define TEST_UDP_RATE_KBPS 2000
+#define TEST_PEER_IDLE_MS 500     // A sink stops after this long without data
+#define TEST_UDP_FIN 0x80000000u  // net_manager_bench end marker flag
+
+// Start of a net_manager_bench datagram, network byte order
+typedef struct {
+    uint32_t seq;
+    uint32_t time_hi;
+    uint32_t time_lo;
+} udp_hdr_t;
+
+static SemaphoreHandle_t s_peer_ready;
+static SemaphoreHandle_t s_peer_done;
+static uint64_t s_peer_bytes;
+static uint32_t s_peer_datagrams;
+static int s_failures;
+
+#define CHECK(cond)                                              \
+    do                                                           \
+    {                                                            \
+        if (!(cond))                                             \
+        {                                                        \
+            ESP_LOGE(TAG, "%s:%d: %s", __func__, __LINE__, #cond); \
+            s_failures++;                                        \
+        }                                                        \
+    } while (0)
+
+/**
+ * @brief Binds a socket to the test port on all addresses, with a receive timeout.
+ */
+static int peer_socket(int type)
+{
+    int fd = socket(AF_INET, type, 0);
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct timeval tv = {.tv_sec = 0, .tv_usec = TEST_PEER_IDLE_MS * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+static struct sockaddr_in loopback_addr(void)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(TEST_PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    return addr;
+}
+
+/**
+ * @brief TCP sink for the benchmark client: counts the bytes of one connection.
+ */
+static void tcp_sink_task(void *arg)
+{
+    int fd = peer_socket(SOCK_STREAM);
+    struct sockaddr_in addr = loopback_addr();
+    bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    listen(fd, 1);
+    xSemaphoreGive(s_peer_ready);
+    int conn = accept(fd, NULL, NULL);
+    static uint8_t buf[1460];
+    int n;
+    while (conn >= 0 && (n = recv(conn, buf, sizeof(buf), 0)) != 0)
+    {
+        if (n > 0)
+            s_peer_bytes += n;
+        else if (errno != EAGAIN && errno != EWOULDBLOCK)
+            break;
+    }
+    close(conn);
+    close(fd);
+    xSemaphoreGive(s_peer_done);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief TCP source for the benchmark server: sends TEST_TCP_BYTES, then closes.
+ */
+static void tcp_source_task(void *arg)
+{
+    struct sockaddr_in addr = loopback_addr();
+    int fd = -1;
+    for (int tries = 0; tries < 50; tries++)
+    {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+            break;
+        close(fd);
+        fd = -1;
+        vTaskDelay(pdMS_TO_TICKS(20)); // Server not listening yet
+    }
+    static uint8_t buf[1024];
+    for (int sent = 0; fd >= 0 && sent < TEST_TCP_BYTES;)
+    {
+        int n = send(fd, buf, sizeof(buf), 0);
+        if (n <= 0)
+            break;
+        sent += n;
+        s_peer_bytes += n;
+    }
+    close(fd);
+    xSemaphoreGive(s_peer_done);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief UDP sink for the benchmark client: counts datagrams until the sender goes quiet.
+ */
+static void udp_sink_task(void *arg)
+{
+    int fd = peer_socket(SOCK_DGRAM);
+    struct sockaddr_in addr = loopback_addr();
+    bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    xSemaphoreGive(s_peer_ready);
+    static uint8_t buf[1500];
+    bool started = false;
+    for (;;)
+    {
+        int n = recv(fd, buf, sizeof(buf), 0);
+        if (n < 0)
+        {
+            if (started)
+                break;
+            continue;
+        }
+        udp_hdr_t hdr;
+        memcpy(&hdr, buf, sizeof(hdr));
+        if (ntohl(hdr.seq) & TEST_UDP_FIN)
+            break;
+        started = true;
+        s_peer_bytes += n;
+        s_peer_datagrams++;
+    }
+    close(fd);
+    xSemaphoreGive(s_peer_done);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief UDP source for the benchmark server: numbered datagrams with one gap, then
+ *        the end markers.
+ */
+static void udp_source_task(void *arg)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr = loopback_addr();
+    vTaskDelay(pdMS_TO_TICKS(200)); // Let the server bind
+    uint8_t buf[64] = {0};
+    for (uint32_t seq = 0; seq <= TEST_UDP_DATAGRAMS; seq++)
+    {
+        bool fin = (seq == TEST_UDP_DATAGRAMS);
+        if (seq == TEST_UDP_SKIPPED_SEQ)
+            continue;
+        udp_hdr_t hdr = {.seq = htonl(fin ? (seq | TEST_UDP_FIN) : seq)};
+        memcpy(buf, &hdr, sizeof(hdr));
+        sendto(fd, buf, sizeof(buf), 0, (struct sockaddr *)&addr, sizeof(addr));
+        if (!fin)
+        {
+            s_peer_datagrams++;
+            s_peer_bytes += sizeof(buf);
+        }
+        vTaskDelay(1);
+    }
+    close(fd);
+    xSemaphoreGive(s_peer_done);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Runs one benchmark against a peer task and waits for both to finish.
+ */
+static esp_err_t run_with_peer(net_bench_proto_t proto, net_bench_role_t role, TaskFunction_t peer, net_bench_result_t *result)
+{
+    s_peer_bytes = 0;
+    s_peer_datagrams = 0;
+    xTaskCreate(peer, "bench_peer", 4096, NULL, 5, NULL);
+    if (role == NET_BENCH_CLIENT)
+        xSemaphoreTake(s_peer_ready, portMAX_DELAY);
+
+    net_bench_config_t config = {
+        .proto = proto,
+        .role = role,
+        .port = TEST_PORT,
+        .duration_s = TEST_DURATION_S,
+        .udp_rate_kbps = TEST_UDP_RATE_KBPS,
+        .remote.addr = htonl(INADDR_LOOPBACK),
+    };
+    esp_err_t err = net_manager_bench_run(&config, result);
+    xSemaphoreTake(s_peer_done, portMAX_DELAY);
+    return err;
+}
+
+static void test_tcp_client(void)
+{
+    net_bench_result_t result;
+    CHECK(run_with_peer(NET_BENCH_TCP, NET_BENCH_CLIENT, tcp_sink_task, &result) == ESP_OK);
+    CHECK(result.bytes > 0);
+    CHECK(result.bytes == s_peer_bytes);
+    CHECK(result.throughput_kbps > 0);
+}
+
+static void test_tcp_server(void)
+{
+    net_bench_result_t result;
+    CHECK(run_with_peer(NET_BENCH_TCP, NET_BENCH_SERVER, tcp_source_task, &result) == ESP_OK);
+    CHECK(result.bytes == TEST_TCP_BYTES);
+    CHECK(result.bytes == s_peer_bytes);
+}
+
+static void test_udp_client(void)
+{
+    net_bench_result_t result;
+    CHECK(run_with_peer(NET_BENCH_UDP, NET_BENCH_CLIENT, udp_sink_task, &result) == ESP_OK);
+    CHECK(result.packets > 0);
+    CHECK(s_peer_datagrams > 0 && s_peer_datagrams <= result.packets);
+    // Paced at TEST_UDP_RATE_KBPS, the rate must come out close to it.
+    CHECK(result.throughput_kbps > TEST_UDP_RATE_KBPS / 2 && result.throughput_kbps < TEST_UDP_RATE_KBPS * 2);
+}
+
+static void test_udp_server(void)
+{
+    net_bench_result_t result;
+    CHECK(run_with_peer(NET_BENCH_UDP, NET_BENCH_SERVER, udp_source_task, &result) == ESP_OK);
+    CHECK(result.packets == s_peer_datagrams);
+    CHECK(result.bytes == s_peer_bytes);
+    CHECK(result.lost == 1);
+    CHECK(result.out_of_order == 0);
+}
+
+static void test_invalid_config(void)
+{
+    net_bench_result_t result;
+    net_bench_config_t config = {.proto = NET_BENCH_TCP, .role = NET_BENCH_CLIENT}; // No remote
+    CHECK(net_manager_bench_run(&config, &result) == ESP_ERR_INVALID_ARG);
+#if CONFIG_IDF_TARGET_LINUX
+    config.remote.addr = htonl(INADDR_LOOPBACK);
+    config.bind_source = true; // No net_manager on the host
+    CHECK(net_manager_bench_run(&config, &result) == ESP_ERR_NOT_SUPPORTED);
+#endif
+}
+
+void app_main(void)
+{
+    s_peer_ready = xSemaphoreCreateBinary();
+    s_peer_done = xSemaphoreCreateBinary();
+
+    test_invalid_config();
+    test_tcp_client();
+    test_tcp_server();
+    test_udp_client();
+    test_udp_server();
+
+    printf("Bench loopback: %s (%d failed checks)\n", s_failures ? "FAIL" : "PASS", s_failures);
+    fflush(stdout);
+    exit(s_failures ? 1 : 0);
+}
@@ -0,0 +1,8 @@
+import pytest
+from pytest_embedded import Dut
+
+
+@pytest.mark.linux
+@pytest.mark.host_test
+def test_bench_loopback(dut: Dut) -> None:
+    dut.expect_exact('Bench loopback: PASS', timeout=60)
@@ -0,0 +1,366 @@
+/**
+ * @file net_manager_config.c
+ *
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "net_manager_config.h"
+
+// Tag-length-value fields of a section. Tags are permanent: never renumber or reuse one.
+typedef enum {
+    TLV_UINT,  // Unsigned integer or bool, value is a varint
+    TLV_BYTES, // Fixed-size binary (addresses), skipped if the stored length differs
+    TLV_STR,   // NUL-terminated string, stored without the terminator
+} tlv_kind_t;
+typedef struct {
+    uint8_t tag;
+    uint8_t kind;
+    uint16_t offset; // In net_manager_config_t
+    uint16_t size;
+} tlv_field_t;
+#define TLV_FIELD(tag, kind, member) \
+    {tag, kind, offsetof(net_manager_config_t, member), sizeof(((net_manager_config_t *)0)->member)}
+
+static const tlv_field_t s_tlv_enable_fields[] = {
+    TLV_FIELD(1, TLV_UINT, wifi_sta_enabled),
+    TLV_FIELD(2, TLV_UINT, wifi_ap_enabled),
+    TLV_FIELD(3, TLV_UINT, ethernet_enabled),
+    TLV_FIELD(4, TLV_UINT, wifi_buffer_profile),
+    TLV_FIELD(5, TLV_UINT, wifi_buffers.static_rx_buf_num),
+    TLV_FIELD(6, TLV_UINT, wifi_buffers.dynamic_rx_buf_num),
+    TLV_FIELD(7, TLV_UINT, wifi_buffers.static_tx_buf_num),
+    TLV_FIELD(8, TLV_UINT, wifi_buffers.dynamic_tx_buf_num),
+    TLV_FIELD(9, TLV_UINT, wifi_buffers.cache_tx_buf_num),
+    TLV_FIELD(10, TLV_UINT, wifi_buffers.ampdu_rx_win),
+    TLV_FIELD(11, TLV_UINT, wifi_buffers.ampdu_tx_enable),
+    TLV_FIELD(12, TLV_UINT, wifi_buffers.nvs_enable),
+};
+static const tlv_field_t s_tlv_sta_fields[] = {
+    TLV_FIELD(1, TLV_STR, wifi_sta_config.ssid),
+    TLV_FIELD(2, TLV_STR, wifi_sta_config.password),
+    TLV_FIELD(3, TLV_UINT, wifi_sta_config.use_static_ip),
+    TLV_FIELD(4, TLV_BYTES, wifi_sta_config.ip_info),
+    TLV_FIELD(5, TLV_BYTES, wifi_sta_config.dns1),
+    TLV_FIELD(6, TLV_BYTES, wifi_sta_config.dns2),
+};
+static const tlv_field_t s_tlv_ap_fields[] = {
+    TLV_FIELD(1, TLV_STR, wifi_ap_config.ssid),
+    TLV_FIELD(2, TLV_STR, wifi_ap_config.password),
+    TLV_FIELD(3, TLV_UINT, wifi_ap_config.on_demand),
+    TLV_FIELD(4, TLV_UINT, wifi_ap_config.channel),
+    TLV_FIELD(5, TLV_UINT, wifi_ap_config.max_connections),
+    TLV_FIELD(6, TLV_BYTES, wifi_ap_config.ip_info),
+    TLV_FIELD(7, TLV_BYTES, wifi_ap_config.dhcp_pool_start),
+    TLV_FIELD(8, TLV_BYTES, wifi_ap_config.dhcp_pool_end),
+    TLV_FIELD(9, TLV_UINT, wifi_ap_config.dhcp_lease_time_min),
+    TLV_FIELD(10, TLV_BYTES, wifi_ap_config.dns_offer),
+    TLV_FIELD(11, TLV_UINT, wifi_ap_config.auto_off_delay_s),
+    TLV_FIELD(12, TLV_UINT, wifi_ap_config.auto_on_delay_s),
+    TLV_FIELD(13, TLV_UINT, wifi_ap_config.auto_on_failed_retries),
+};
+static const tlv_field_t s_tlv_eth_fields[] = {
+    TLV_FIELD(1, TLV_UINT, ethernet_config.use_static_ip),
+    TLV_FIELD(2, TLV_BYTES, ethernet_config.ip_info),
+    TLV_FIELD(3, TLV_BYTES, ethernet_config.dns1),
+    TLV_FIELD(4, TLV_BYTES, ethernet_config.dns2),
+    TLV_FIELD(5, TLV_UINT, ethernet_config.rx_task_priority),
+    TLV_FIELD(6, TLV_UINT, ethernet_config.flow_control),
+    TLV_FIELD(7, TLV_UINT, ethernet_config.rx_task_stack_size),
+    TLV_FIELD(8, TLV_UINT, ethernet_config.rx_task_pinned),
+    TLV_FIELD(9, TLV_UINT, ethernet_config.rx_task_core),
+};
+
+typedef struct {
+    const char *key;
+    size_t v1_size; // Raw struct size in NVS_CONFIG_VERSION_RAW (1) blobs
+    const tlv_field_t *fields;
+    size_t num_fields;
+} config_section_t;
+#define CONFIG_SECTION(key, v1_size, fields) {key, v1_size, fields, sizeof(fields) / sizeof(fields[0])}
+static const config_section_t s_sections[NM_CONFIG_SECTION_COUNT] = {
+    [NM_CONFIG_SECTION_ENABLE] = CONFIG_SECTION("cfg_en", sizeof(legacy_enable_v1_t), s_tlv_enable_fields),
+    [NM_CONFIG_SECTION_STA] = CONFIG_SECTION("cfg_sta", sizeof(legacy_sta_v0_t), s_tlv_sta_fields),
+    [NM_CONFIG_SECTION_AP] = CONFIG_SECTION("cfg_ap", sizeof(legacy_ap_v1_t), s_tlv_ap_fields),
+    [NM_CONFIG_SECTION_ETH] = CONFIG_SECTION("cfg_eth", sizeof(legacy_eth_v0_t), s_tlv_eth_fields),
+};
+
+/**
+ * @brief Appends a varint (7 bits per byte, LSB first).
+ * @return Bytes written, 0 if it does not fit.
+ */
+static size_t tlv_put_varint(uint8_t *buf, size_t cap, uint32_t value)
+{
+    size_t n = 0;
+    do
+    {
+        if (n >= cap)
+            return 0;
+        buf[n++] = (value & 0x7F) | ((value > 0x7F) ? 0x80 : 0);
+        value >>= 7;
+    } while (value);
+    return n;
+}
+
+/**
+ * @brief Reads a varint.
+ * @return Bytes consumed, 0 if truncated or longer than 32 bits.
+ */
+static size_t tlv_get_varint(const uint8_t *data, size_t len, uint32_t *value)
+{
+    *value = 0;
+    for (size_t n = 0; n < len && n < 5; n++)
+    {
+        *value |= (uint32_t)(data[n] & 0x7F) << (7 * n);
+        if (!(data[n] & 0x80))
+            return n + 1;
+    }
+    return 0;
+}
+
+const char *nm_config_section_key(size_t index)
+{
+    return (index < NM_CONFIG_SECTION_COUNT) ? s_sections[index].key : NULL;
+}
+
+size_t nm_config_section_encode(size_t index, const net_manager_config_t *config, uint8_t *buf, size_t cap)
+{
+    if (index >= NM_CONFIG_SECTION_COUNT)
+        return 0;
+    const config_section_t *section = &s_sections[index];
+    size_t pos = 0;
+    for (size_t i = 0; i < section->num_fields; i++)
+    {
+        const tlv_field_t *field = &section->fields[i];
+        const uint8_t *src = (const uint8_t *)config + field->offset;
+        uint8_t value[9]; // Largest UINT varint (5) and room to spare
+        const uint8_t *value_ptr = src;
+        size_t value_len;
+        if (field->kind == TLV_UINT)
+        {
+            uint32_t v = 0;
+            if (field->size == sizeof(uint8_t))
+                v = *src;
+            else if (field->size == sizeof(uint16_t))
+                v = *(const uint16_t *)src;
+            else
+                v = *(const uint32_t *)src;
+            value_len = tlv_put_varint(value, sizeof(value), v);
+            value_ptr = value;
+        }
+        else if (field->kind == TLV_STR)
+        {
+            value_len = strnlen((const char *)src, field->size - 1);
+        }
+        else
+        {
+            value_len = field->size;
+        }
+
+        size_t n = tlv_put_varint(buf + pos, cap - pos, field->tag);
+        if (n == 0)
+            return 0;
+        pos += n;
+        n = tlv_put_varint(buf + pos, cap - pos, value_len);
+        if (n == 0 || cap - pos - n < value_len)
+            return 0;
+        pos += n;
+        memcpy(buf + pos, value_ptr, value_len);
+        pos += value_len;
+    }
+    return pos;
+}
+
+void nm_config_section_decode(size_t index, const uint8_t *data, size_t len, net_manager_config_t *config)
+{
+    if (index >= NM_CONFIG_SECTION_COUNT)
+        return;
+    const config_section_t *section = &s_sections[index];
+    size_t pos = 0;
+    while (pos < len)
+    {
+        uint32_t tag, value_len;
+        size_t n = tlv_get_varint(data + pos, len - pos, &tag);
+        if (n == 0)
+            break;
+        pos += n;
+        n = tlv_get_varint(data + pos, len - pos, &value_len);
+        if (n == 0 || len - pos - n < value_len)
+            break; // Truncated record
+        pos += n;
+        const uint8_t *value = data + pos;
+        pos += value_len;
+
+        const tlv_field_t *field = NULL;
+        for (size_t i = 0; i < section->num_fields; i++)
+        {
+            if (section->fields[i].tag == tag)
+                field = &section->fields[i];
+        }
+        if (!field)
+            continue; // Written by newer firmware
+
+        uint8_t *dst = (uint8_t *)config + field->offset;
+        if (field->kind == TLV_UINT)
+        {
+            uint32_t v;
+            if (tlv_get_varint(value, value_len, &v) == 0)
+                continue;
+            if (field->size == sizeof(uint8_t))
+                *dst = (uint8_t)v;
+            else if (field->size == sizeof(uint16_t))
+                *(uint16_t *)dst = (uint16_t)v;
+            else
+                *(uint32_t *)dst = v;
+        }
+        else if (field->kind == TLV_STR)
+        {
+            size_t copy = (value_len < field->size) ? value_len : field->size - 1;
+            memset(dst, 0, field->size);
+            memcpy(dst, value, copy);
+        }
+        else if (value_len == field->size)
+        {
+            memcpy(dst, value, field->size);
+        }
+    }
+}
+
+size_t nm_config_encode(const net_manager_config_t *config, uint8_t *buf, size_t cap)
+{
+    size_t pos = 0;
+    for (size_t i = 0; i < NM_CONFIG_SECTION_COUNT; i++)
+    {
+        uint8_t section[NM_CONFIG_SECTION_BUF_SIZE];
+        size_t len = nm_config_section_encode(i, config, section, sizeof(section));
+        if (len == 0)
+            return 0;
+        size_t n = tlv_put_varint(buf + pos, cap - pos, i);
+        if (n == 0)
+            return 0;
+        pos += n;
+        n = tlv_put_varint(buf + pos, cap - pos, len);
+        if (n == 0 || cap - pos - n < len)
+            return 0;
+        pos += n;
+        memcpy(buf + pos, section, len);
+        pos += len;
+    }
+    return pos;
+}
+
+void nm_config_decode(const uint8_t *data, size_t len, net_manager_config_t *config)
+{
+    size_t pos = 0;
+    while (pos < len)
+    {
+        uint32_t index, section_len;
+        size_t n = tlv_get_varint(data + pos, len - pos, &index);
+        if (n == 0)
+            break;
+        pos += n;
+        n = tlv_get_varint(data + pos, len - pos, &section_len);
+        if (n == 0 || len - pos - n < section_len)
+            break;
+        pos += n;
+        nm_config_section_decode(index, data + pos, section_len, config); // Ignores unknown sections
+        pos += section_len;
+    }
+}
+
+/**
+ * @brief Copies a string of a frozen layout, which may lack its terminator.
+ */
+static void legacy_copy_str(char *dst, size_t dst_size, const char *src, size_t src_size)
+{
+    size_t len = strnlen(src, src_size);
+    if (len >= dst_size)
+        len = dst_size - 1;
+    memset(dst, 0, dst_size);
+    memcpy(dst, src, len);
+}
+
+static void legacy_apply_sta_v0(const legacy_sta_v0_t *sta, net_config_wifi_sta_t *out)
+{
+    legacy_copy_str(out->ssid, sizeof(out->ssid), sta->ssid, sizeof(sta->ssid));
+    legacy_copy_str(out->password, sizeof(out->password), sta->password, sizeof(sta->password));
+    out->use_static_ip = sta->use_static_ip;
+    out->ip_info = sta->ip_info;
+    out->dns1 = sta->dns1;
+    out->dns2 = sta->dns2;
+}
+
+static void legacy_apply_eth_v0(const legacy_eth_v0_t *eth, net_config_ethernet_t *out)
+{
+    out->use_static_ip = eth->use_static_ip;
+    out->ip_info = eth->ip_info;
+    out->dns1 = eth->dns1;
+    out->dns2 = eth->dns2;
+}
+
+bool nm_config_decode_v0(const void *blob, size_t len, net_manager_config_t *config)
+{
+    legacy_config_v0_t v0;
+    if (len != sizeof(v0))
+        return false;
+    memcpy(&v0, blob, sizeof(v0)); // The blob may be unaligned
+
+    config->wifi_sta_enabled = v0.wifi_sta_enabled;
+    config->wifi_ap_enabled = v0.wifi_ap_enabled;
+    config->ethernet_enabled = v0.ethernet_enabled;
+    legacy_apply_sta_v0(&v0.wifi_sta_config, &config->wifi_sta_config);
+    net_config_wifi_ap_t *ap = &config->wifi_ap_config;
+    legacy_copy_str(ap->ssid, sizeof(ap->ssid), v0.wifi_ap_config.ssid, sizeof(v0.wifi_ap_config.ssid));
+    legacy_copy_str(ap->password, sizeof(ap->password), v0.wifi_ap_config.password, sizeof(v0.wifi_ap_config.password));
+    ap->channel = v0.wifi_ap_config.channel;
+    ap->max_connections = v0.wifi_ap_config.max_connections;
+    legacy_apply_eth_v0(&v0.ethernet_config, &config->ethernet_config);
+    return true;
+}
+
+bool nm_config_decode_v1_section(size_t index, const void *blob, size_t len, net_manager_config_t *config)
+{
+    if (index >= NM_CONFIG_SECTION_COUNT || len != s_sections[index].v1_size)
+        return false;
+
+    if (index == NM_CONFIG_SECTION_ENABLE)
+    {
+        legacy_enable_v1_t en;
+        memcpy(&en, blob, sizeof(en));
+        config->wifi_sta_enabled = en.wifi_sta_enabled;
+        config->wifi_ap_enabled = en.wifi_ap_enabled;
+        config->ethernet_enabled = en.ethernet_enabled;
+    }
+    else if (index == NM_CONFIG_SECTION_STA)
+    {
+        legacy_sta_v0_t sta;
+        memcpy(&sta, blob, sizeof(sta));
+        legacy_apply_sta_v0(&sta, &config->wifi_sta_config);
+    }
+    else if (index == NM_CONFIG_SECTION_AP)
+    {
+        legacy_ap_v1_t v1;
+        memcpy(&v1, blob, sizeof(v1));
+        net_config_wifi_ap_t *ap = &config->wifi_ap_config;
+        legacy_copy_str(ap->ssid, sizeof(ap->ssid), v1.ssid, sizeof(v1.ssid));
+        legacy_copy_str(ap->password, sizeof(ap->password), v1.password, sizeof(v1.password));
+        ap->on_demand = v1.on_demand;
+        ap->channel = v1.channel;
+        ap->max_connections = v1.max_connections;
+        ap->ip_info = v1.ip_info;
+        ap->dhcp_pool_start = v1.dhcp_pool_start;
+        ap->dhcp_pool_end = v1.dhcp_pool_end;
+        ap->dhcp_lease_time_min = v1.dhcp_lease_time_min;
+        ap->dns_offer = v1.dns_offer;
+        ap->auto_off_delay_s = v1.auto_off_delay_s;
+        ap->auto_on_delay_s = v1.auto_on_delay_s;
+        ap->auto_on_failed_retries = v1.auto_on_failed_retries;
+    }
+    else
+    {
+        legacy_eth_v0_t eth;
+        memcpy(&eth, blob, sizeof(eth));
+        legacy_apply_eth_v0(&eth, &config->ethernet_config);
+    }
+    return true;
+}
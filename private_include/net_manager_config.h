@@ -0,0 +1,129 @@
+#ifndef NET_MANAGER_CONFIG_H
+#define NET_MANAGER_CONFIG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "net_manager.h"
+
+/*
+ * Config encoding shared by NVS, the factory partition and the profiles. Pure C with no
+ * ESP-IDF services, so host_test/config_codec can test it on the build machine.
+ *
+ * The config is split into sections (enable flags and Wi-Fi buffers, STA, AP, ETH). Each
+ * section is a sequence of <tag varint><length varint><value> records; decoding applies
+ * them on top of the caller's config and skips unknown tags, so blobs written by older or
+ * newer firmware load into this struct layout.
+ */
+
+// The index of a section is its ID in the factory partition and in profiles, keep the order.
+#define NM_CONFIG_SECTION_ENABLE 0
+#define NM_CONFIG_SECTION_STA 1
+#define NM_CONFIG_SECTION_AP 2
+#define NM_CONFIG_SECTION_ETH 3
+#define NM_CONFIG_SECTION_COUNT 4
+#define NM_CONFIG_SECTION_BUF_SIZE 256 // Largest encoded section (AP) is well below this
+
+/*
+ * Frozen layouts of older firmware, only used to migrate what it stored. Never edit them.
+ */
+
+// Baseline firmware: the whole net_manager_config_t in one blob (NVS key "net_config").
+typedef struct {
+    char ssid[32];
+    char password[64];
+    bool use_static_ip;
+    esp_netif_ip_info_t ip_info;
+    esp_ip4_addr_t dns1;
+    esp_ip4_addr_t dns2;
+} legacy_sta_v0_t;
+
+typedef struct {
+    char ssid[32];
+    char password[64];
+    uint8_t channel;
+    uint8_t max_connections;
+} legacy_ap_v0_t;
+
+typedef struct {
+    bool use_static_ip;
+    esp_netif_ip_info_t ip_info;
+    esp_ip4_addr_t dns1;
+    esp_ip4_addr_t dns2;
+} legacy_eth_v0_t;
+
+typedef struct {
+    bool wifi_sta_enabled;
+    bool wifi_ap_enabled;
+    bool ethernet_enabled;
+    legacy_sta_v0_t wifi_sta_config;
+    legacy_ap_v0_t wifi_ap_config;
+    legacy_eth_v0_t ethernet_config;
+} legacy_config_v0_t;
+
+// NVS config version 1: one raw struct per section. STA and ETH are the v0 layouts.
+typedef struct {
+    bool wifi_sta_enabled;
+    bool wifi_ap_enabled;
+    bool ethernet_enabled;
+} legacy_enable_v1_t;
+
+typedef struct {
+    char ssid[32];
+    char password[64];
+    bool on_demand;
+    uint8_t channel;
+    uint8_t max_connections;
+    esp_netif_ip_info_t ip_info;
+    esp_ip4_addr_t dhcp_pool_start;
+    esp_ip4_addr_t dhcp_pool_end;
+    uint32_t dhcp_lease_time_min;
+    esp_ip4_addr_t dns_offer;
+    uint16_t auto_off_delay_s;
+    uint16_t auto_on_delay_s;
+    uint8_t auto_on_failed_retries;
+} legacy_ap_v1_t;
+
+/**
+ * @brief NVS key of a section.
+ */
+const char *nm_config_section_key(size_t index);
+
+/**
+ * @brief Encodes one section into tag-length-value records.
+ * @return Encoded size, 0 if the buffer is too small.
+ */
+size_t nm_config_section_encode(size_t index, const net_manager_config_t *config, uint8_t *buf, size_t cap);
+
+/**
+ * @brief Applies the records of one encoded section on top of config. Unknown tags and
+ *        values that no longer fit their field are skipped, a truncated tail is ignored.
+ */
+void nm_config_section_decode(size_t index, const uint8_t *data, size_t len, net_manager_config_t *config);
+
+/**
+ * @brief Encodes a whole config as <section index varint><length varint><section records>,
+ *        the format of the factory partition payload and of stored profiles.
+ * @return Encoded size, 0 if the buffer is too small.
+ */
+size_t nm_config_encode(const net_manager_config_t *config, uint8_t *buf, size_t cap);
+
+/**
+ * @brief Applies a config encoded by nm_config_encode() on top of config. Unknown sections
+ *        are skipped, a truncated tail is ignored.
+ */
+void nm_config_decode(const uint8_t *data, size_t len, net_manager_config_t *config);
+
+/**
+ * @brief Applies a baseline firmware blob (legacy_config_v0_t) on top of config.
+ * @return false if len is not the size of that layout; config is then unchanged.
+ */
+bool nm_config_decode_v0(const void *blob, size_t len, net_manager_config_t *config);
+
+/**
+ * @brief Applies one raw section of NVS config version 1 on top of config.
+ * @return false if len is not the size of that section's layout; config is then unchanged.
+ */
+bool nm_config_decode_v1_section(size_t index, const void *blob, size_t len, net_manager_config_t *config);
+
+#endif // NET_MANAGER_CONFIG_H
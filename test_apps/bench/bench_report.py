@@ -0,0 +1,95 @@
+#!/usr/bin/env python
+"""Compares the results of test_apps/bench across builds. Each log is the DUT console of
+one build (idf.py monitor output saved to a file); its "BENCH <scenario> stat=median ..."
+and "stat=dist" (percentiles) lines are tabulated side by side, with the change against
+the baseline build.
+
+    cd test_apps/bench
+    idf.py -B build_hooks_on -D SDKCONFIG_DEFAULTS="sdkconfig.defaults;sdkconfig.ci.hooks_on" flash monitor | tee hooks_on.log
+    idf.py -B build_hooks_off -D SDKCONFIG_DEFAULTS="sdkconfig.defaults;sdkconfig.ci.hooks_off" flash monitor | tee hooks_off.log
+    python bench_report.py --baseline hooks_off --max-overhead 1 hooks_on.log hooks_off.log
+
+--max-overhead fails the report if the throughput of a build is more than that many percent
+below the baseline, or its CPU load more than that many percent above it. Other metrics
+(latencies in ms) are only tabulated, e.g. the first-packet latency of prewarm_on against
+prewarm_off.
+"""
+import argparse
+import os
+import re
+import sys
+
+LINE = re.compile(r'^BENCH (\S+) (.*)$')
+
+
+def parse_log(path):
+    medians = {}
+    with open(path, errors='replace') as f:
+        for line in f:
+            m = LINE.match(line.strip())
+            if not m:
+                continue
+            fields = dict(kv.split('=', 1) for kv in m.group(2).split() if '=' in kv)
+            # Per-run lines carry no stat; the summary is a median or a distribution
+            if fields.pop('stat', None) not in ('median', 'dist'):
+                continue
+            # A scenario may report one median line per variant (e.g. a profile or mode)
+            variant = fields.pop('variant', '')
+            key = m.group(1) + ('/' + variant if variant else '')
+            medians[key] = {k: float(v) for k, v in fields.items()}
+    return medians
+
+
+def overhead_pct(metric, value, base):
+    if not base:
+        return 0.0
+    if metric.startswith('kbps'):
+        return (base - value) * 100.0 / base  # Lower throughput is worse
+    if metric.startswith('cpu'):
+        return value - base                   # Load is already in percent
+    return 0.0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--baseline', help='build name (log file name without extension) to compare against')
+    parser.add_argument('--max-overhead', type=float, help='fail above this throughput/CPU overhead in percent')
+    parser.add_argument('logs', nargs='+')
+    args = parser.parse_args()
+
+    builds = {os.path.splitext(os.path.basename(p))[0]: parse_log(p) for p in args.logs}
+    base = builds.get(args.baseline) if args.baseline else None
+    if args.baseline and base is None:
+        sys.exit('no log for baseline %s' % args.baseline)
+
+    failed = False
+    scenarios = sorted({s for r in builds.values() for s in r})
+    for scenario in scenarios:
+        metrics = sorted({k for r in builds.values() for k in r.get(scenario, {})})
+        print('\n### %s\n' % scenario)
+        print('| Build | ' + ' | '.join(metrics) + ' |')
+        print('|---' * (len(metrics) + 1) + '|')
+        for name, results in builds.items():
+            row = results.get(scenario, {})
+            cells = []
+            for metric in metrics:
+                value = row.get(metric)
+                if value is None:
+                    cells.append('-')
+                    continue
+                cell = '%g' % value
+                base_value = base.get(scenario, {}).get(metric) if base else None
+                if base_value is not None and results is not base:
+                    if base_value:
+                        cell += ' (%+.1f%%)' % ((value - base_value) * 100.0 / base_value)
+                    overhead = overhead_pct(metric, value, base_value)
+                    if args.max_overhead is not None and overhead > args.max_overhead:
+                        cell += ' FAIL'
+                        failed = True
+                cells.append(cell)
+            print('| %s | %s |' % (name, ' | '.join(cells)))
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,387 @@
+/**
+ * @file bench_main.c
+ *
+ * Runtime benchmark of net_manager on two boards. The DUT runs each scenario
+ * CONFIG_BENCH_RUNS times against the peer and prints one "BENCH <scenario> key=value ..."
+ * line per run and a "stat=median" line per scenario, or per variant of one, which
+ * bench_report.py compares across builds. The power-save scenario prints RTT percentiles
+ * ("stat=dist") instead. The peer serves the runs until it is reset.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "ping/ping_sock.h"
+#include "sdkconfig.h"
+#include "net_manager.h"
+#include "net_manager_bench.h"
+
+static const char *TAG = "NET_BENCH_APP";
+#define BENCH_CONNECT_TIMEOUT_MS 30000
+#define BENCH_CLIENT_TRIES 10 // The peer may still be starting its server
+#define BENCH_CLIENT_RETRY_MS 1000
+#define BENCH_PING_TIMEOUT_MS 1000
+#if CONFIG_NET_MANAGER_TRAFFIC_HOOKS_ENABLED
+#define BENCH_TRAFFIC_HOOKS 1
+#else
+#define BENCH_TRAFFIC_HOOKS 0
+#endif
+
+static SemaphoreHandle_t s_connected;
+static int64_t s_connected_us; // esp_timer time of the last STA CONNECTED event
+
+static void bench_event(const net_manager_event_t *event)
+{
+    if (event->source == NET_EVENT_SOURCE_STA && event->status == NET_STATUS_CONNECTED)
+    {
+        s_connected_us = esp_timer_get_time();
+        xSemaphoreGive(s_connected);
+    }
+}
+
+/**
+ * @brief (Re)starts net_manager and waits until the STA is connected.
+ * @param config The config to start, NULL for the Kconfig defaults.
+ * @return Time from the start to NET_STATUS_CONNECTED, in microseconds.
+ */
+static int64_t bench_restart(const net_manager_config_t *config)
+{
+    net_manager_stop();
+    xSemaphoreTake(s_connected, 0); // A late event of the previous run
+    int64_t start_us = esp_timer_get_time();
+    ESP_ERROR_CHECK(net_manager_start(config));
+    if (xSemaphoreTake(s_connected, pdMS_TO_TICKS(BENCH_CONNECT_TIMEOUT_MS)) != pdTRUE)
+    {
+        ESP_LOGE(TAG, "STA did not connect, check CONFIG_NET_MANAGER_WIFI_STA_SSID_DEFAULT");
+        abort();
+    }
+    return s_connected_us - start_us;
+}
+
+/**
+ * @brief Starts the STA from the Kconfig defaults and waits until it is connected.
+ *        NVS is erased first so no stored config changes the setup between builds.
+ */
+static void bench_connect(void)
+{
+    ESP_ERROR_CHECK(nvs_flash_erase());
+    ESP_ERROR_CHECK(nvs_flash_init());
+    s_connected = xSemaphoreCreateBinary();
+    ESP_ERROR_CHECK(net_manager_init(bench_event));
+    bench_restart(NULL);
+}
+
+#if CONFIG_BENCH_ROLE_DUT
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Median of n values; sorts them.
+ */
+static uint32_t median_u32(uint32_t *values, int n)
+{
+    qsort(values, n, sizeof(values[0]), compare_u32);
+    return (n % 2) ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+/**
+ * @brief Nearest-rank percentile of n sorted values.
+ */
+static uint32_t percentile_u32(const uint32_t *sorted, int n, int pct)
+{
+    int rank = (n * pct + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+typedef struct {
+    SemaphoreHandle_t done;
+    uint32_t *rtt_ms;
+    int replies;
+    int lost;
+} bench_ping_t;
+
+static void bench_ping_success(esp_ping_handle_t hdl, void *args)
+{
+    bench_ping_t *ping = (bench_ping_t *)args;
+    uint32_t elapsed_ms;
+    esp_ping_get_profile(hdl, ESP_PING_PROF_TIMEGAP, &elapsed_ms, sizeof(elapsed_ms));
+    ping->rtt_ms[ping->replies++] = elapsed_ms;
+}
+
+static void bench_ping_timeout(esp_ping_handle_t hdl, void *args)
+{
+    ((bench_ping_t *)args)->lost++;
+}
+
+static void bench_ping_end(esp_ping_handle_t hdl, void *args)
+{
+    xSemaphoreGive(((bench_ping_t *)args)->done);
+}
+
+/**
+ * @brief Pings the STA gateway and blocks until the last reply or timeout.
+ * @param count Echo requests to send.
+ * @param interval_ms Time between requests.
+ * @param[out] rtt_ms RTT of each reply, at least count entries.
+ * @param[out] lost Requests that timed out.
+ * @return Number of replies.
+ */
+static int bench_ping_gateway(uint32_t count, uint32_t interval_ms, uint32_t *rtt_ms, int *lost)
+{
+    esp_netif_ip_info_t ip_info;
+    ESP_ERROR_CHECK(net_manager_get_ip_info(NET_EVENT_SOURCE_STA, &ip_info));
+    esp_ping_config_t ping_cfg = ESP_PING_DEFAULT_CONFIG();
+    ping_cfg.target_addr.type = IPADDR_TYPE_V4;
+    ping_cfg.target_addr.u_addr.ip4.addr = ip_info.gw.addr;
+    ping_cfg.count = count;
+    ping_cfg.interval_ms = interval_ms;
+    ping_cfg.timeout_ms = BENCH_PING_TIMEOUT_MS;
+
+    bench_ping_t ping = {.done = xSemaphoreCreateBinary(), .rtt_ms = rtt_ms};
+    esp_ping_callbacks_t cbs = {
+        .on_ping_success = bench_ping_success,
+        .on_ping_timeout = bench_ping_timeout,
+        .on_ping_end = bench_ping_end,
+        .cb_args = &ping,
+    };
+    esp_ping_handle_t session;
+    ESP_ERROR_CHECK(esp_ping_new_session(&ping_cfg, &cbs, &session));
+    ESP_ERROR_CHECK(esp_ping_start(session));
+    xSemaphoreTake(ping.done, portMAX_DELAY);
+    esp_ping_delete_session(session);
+    vSemaphoreDelete(ping.done);
+    *lost = ping.lost;
+    return ping.replies;
+}
+
+/**
+ * @brief Time to connect, and RTT of the first packet to the gateway right after
+ *        NET_STATUS_CONNECTED. Without gateway pre-warming the first packet waits for
+ *        the ARP exchange; with it the exchange happens before CONNECTED, which in turn
+ *        comes up to CONFIG_NET_MANAGER_GW_PREWARM_TIMEOUT_MS later. Compare the sum.
+ */
+static void scenario_first_packet(void)
+{
+    uint32_t connect_ms[CONFIG_BENCH_RUNS];
+    uint32_t first_ms[CONFIG_BENCH_RUNS];
+    uint32_t total_ms[CONFIG_BENCH_RUNS];
+    for (int run = 0; run < CONFIG_BENCH_RUNS; run++)
+    {
+        connect_ms[run] = (uint32_t)(bench_restart(NULL) / 1000);
+        int lost;
+        if (bench_ping_gateway(1, 100, &first_ms[run], &lost) == 0)
+            first_ms[run] = BENCH_PING_TIMEOUT_MS;
+        total_ms[run] = connect_ms[run] + first_ms[run];
+        printf("BENCH first_packet run=%d connect_ms=%lu first_ms=%lu\n", run, (unsigned long)connect_ms[run],
+               (unsigned long)first_ms[run]);
+    }
+    printf("BENCH first_packet stat=median connect_ms=%lu first_ms=%lu total_ms=%lu\n",
+           (unsigned long)median_u32(connect_ms, CONFIG_BENCH_RUNS), (unsigned long)median_u32(first_ms, CONFIG_BENCH_RUNS),
+           (unsigned long)median_u32(total_ms, CONFIG_BENCH_RUNS));
+}
+
+/**
+ * @brief Runs one TCP throughput test from the DUT to the peer over the STA.
+ */
+static esp_err_t bench_tcp_client(net_bench_result_t *result)
+{
+    net_bench_config_t config = {
+        .proto = NET_BENCH_TCP,
+        .role = NET_BENCH_CLIENT,
+        .bind_source = true,
+        .source = NET_EVENT_SOURCE_STA,
+        .remote.addr = esp_ip4addr_aton(CONFIG_BENCH_PEER_IP),
+        .duration_s = CONFIG_BENCH_DURATION_S,
+    };
+    esp_err_t err = ESP_FAIL;
+    for (int tries = 0; tries < BENCH_CLIENT_TRIES && err != ESP_OK; tries++)
+    {
+        if (tries)
+            vTaskDelay(pdMS_TO_TICKS(BENCH_CLIENT_RETRY_MS));
+        err = net_manager_bench_run(&config, result);
+    }
+    return err;
+}
+
+/**
+ * @brief TCP throughput and CPU load of the DUT while it sends. Every frame and every ACK
+ *        passes the traffic hooks, so comparing the hooks_on and hooks_off builds gives
+ *        their cost.
+ */
+static void scenario_throughput(void)
+{
+    uint32_t kbps[CONFIG_BENCH_RUNS];
+    uint32_t cpu[NET_BENCH_MAX_CORES][CONFIG_BENCH_RUNS];
+    for (int run = 0; run < CONFIG_BENCH_RUNS; run++)
+    {
+        net_bench_result_t result;
+        ESP_ERROR_CHECK(bench_tcp_client(&result));
+        kbps[run] = result.throughput_kbps;
+        for (int core = 0; core < NET_BENCH_MAX_CORES; core++)
+            cpu[core][run] = result.cpu_load_pct[core];
+        printf("BENCH throughput run=%d kbps=%lu cpu0=%u cpu1=%u\n", run, (unsigned long)result.throughput_kbps,
+               result.cpu_load_pct[0], result.cpu_load_pct[1]);
+    }
+    printf("BENCH throughput stat=median kbps=%lu cpu0=%lu cpu1=%lu\n", (unsigned long)median_u32(kbps, CONFIG_BENCH_RUNS),
+           (unsigned long)median_u32(cpu[0], CONFIG_BENCH_RUNS), (unsigned long)median_u32(cpu[1], CONFIG_BENCH_RUNS));
+}
+
+/**
+ * @brief The Kconfig STA setup with the given Wi-Fi buffer profile.
+ */
+static void bench_sta_config(net_wifi_buffer_profile_t profile, net_manager_config_t *config)
+{
+    memset(config, 0, sizeof(*config));
+    config->wifi_sta_enabled = true;
+    strncpy(config->wifi_sta_config.ssid, CONFIG_NET_MANAGER_WIFI_STA_SSID_DEFAULT, sizeof(config->wifi_sta_config.ssid) - 1);
+    strncpy(config->wifi_sta_config.password, CONFIG_NET_MANAGER_WIFI_STA_PASSWORD_DEFAULT,
+            sizeof(config->wifi_sta_config.password) - 1);
+    config->wifi_buffer_profile = profile;
+}
+
+/**
+ * @brief TCP throughput, CPU load and Wi-Fi heap of each buffer profile, like an iperf run
+ *        per profile. Each profile restarts net_manager, which re-initializes Wi-Fi with it.
+ *        wifi_kb is what esp_wifi_init() and esp_wifi_start() took, free_kb the internal
+ *        heap left while connected.
+ */
+static void scenario_buffer_profiles(void)
+{
+    static const struct {
+        net_wifi_buffer_profile_t profile;
+        const char *name;
+    } profiles[] = {
+        {NET_WIFI_BUFFERS_LOW_MEMORY, "low_memory"},
+        {NET_WIFI_BUFFERS_BALANCED, "balanced"},
+        {NET_WIFI_BUFFERS_HIGH_THROUGHPUT, "high_throughput"},
+    };
+    for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++)
+    {
+        net_manager_config_t config;
+        bench_sta_config(profiles[i].profile, &config);
+        bench_restart(&config);
+        net_memory_report_t mem;
+        ESP_ERROR_CHECK(net_manager_get_memory_report(&mem));
+        int32_t wifi_bytes = mem.phases[NET_MEM_PHASE_WIFI_INIT].internal_bytes +
+                             mem.phases[NET_MEM_PHASE_WIFI_START].internal_bytes;
+
+        uint32_t kbps[CONFIG_BENCH_RUNS];
+        uint32_t cpu[NET_BENCH_MAX_CORES][CONFIG_BENCH_RUNS];
+        for (int run = 0; run < CONFIG_BENCH_RUNS; run++)
+        {
+            net_bench_result_t result;
+            ESP_ERROR_CHECK(bench_tcp_client(&result));
+            kbps[run] = result.throughput_kbps;
+            for (int core = 0; core < NET_BENCH_MAX_CORES; core++)
+                cpu[core][run] = result.cpu_load_pct[core];
+            printf("BENCH buffers variant=%s run=%d kbps=%lu cpu0=%u cpu1=%u\n", profiles[i].name, run,
+                   (unsigned long)result.throughput_kbps, result.cpu_load_pct[0], result.cpu_load_pct[1]);
+        }
+        printf("BENCH buffers stat=median variant=%s kbps=%lu cpu0=%lu cpu1=%lu wifi_kb=%ld free_kb=%u\n", profiles[i].name,
+               (unsigned long)median_u32(kbps, CONFIG_BENCH_RUNS), (unsigned long)median_u32(cpu[0], CONFIG_BENCH_RUNS),
+               (unsigned long)median_u32(cpu[1], CONFIG_BENCH_RUNS), (long)(wifi_bytes / 1024),
+               (unsigned)(mem.internal_free / 1024));
+    }
+    bench_restart(NULL); // Back to the build's own profile for the next scenario
+}
+
+/**
+ * @brief RTT distribution of gateway pings in each power-save mode. The STA is restarted
+ *        after setting the mode, so the AP learns the listen interval of LOW_POWER. AUTO
+ *        stays awake while the pings keep coming; it is skipped when the build has no
+ *        traffic hooks.
+ */
+static void scenario_power_save(void)
+{
+    static const struct {
+        net_power_save_t mode;
+        const char *name;
+    } modes[] = {
+        {NET_POWER_SAVE_MAX_PERF, "max_perf"},
+        {NET_POWER_SAVE_BALANCED, "balanced"},
+        {NET_POWER_SAVE_LOW_POWER, "low_power"},
+        {NET_POWER_SAVE_AUTO, "auto"},
+    };
+    static uint32_t rtt_ms[CONFIG_BENCH_PING_COUNT];
+    net_power_save_t build_mode;
+    ESP_ERROR_CHECK(net_manager_get_power_save(&build_mode, NULL));
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+    {
+        esp_err_t err = net_manager_set_power_save(modes[i].mode);
+        if (err == ESP_ERR_NOT_SUPPORTED)
+        {
+            ESP_LOGI(TAG, "Power save %s not supported by this build, skipped", modes[i].name);
+            continue;
+        }
+        ESP_ERROR_CHECK(err);
+        bench_restart(NULL);
+        int lost;
+        int replies = bench_ping_gateway(CONFIG_BENCH_PING_COUNT, CONFIG_BENCH_PING_INTERVAL_MS, rtt_ms, &lost);
+        if (replies == 0)
+        {
+            printf("BENCH power_save stat=dist variant=%s lost=%d\n", modes[i].name, lost);
+            continue;
+        }
+        qsort(rtt_ms, replies, sizeof(rtt_ms[0]), compare_u32);
+        printf("BENCH power_save stat=dist variant=%s p50_ms=%lu p90_ms=%lu p99_ms=%lu max_ms=%lu lost=%d\n",
+               modes[i].name, (unsigned long)percentile_u32(rtt_ms, replies, 50),
+               (unsigned long)percentile_u32(rtt_ms, replies, 90), (unsigned long)percentile_u32(rtt_ms, replies, 99),
+               (unsigned long)rtt_ms[replies - 1], lost);
+    }
+    ESP_ERROR_CHECK(net_manager_set_power_save(build_mode));
+    bench_restart(NULL);
+}
+#endif // CONFIG_BENCH_ROLE_DUT
+
+#if CONFIG_BENCH_ROLE_PEER
+/**
+ * @brief Receives TCP runs from the DUT, one after another.
+ */
+static void peer_serve(void)
+{
+    net_bench_config_t config = {
+        .proto = NET_BENCH_TCP,
+        .role = NET_BENCH_SERVER,
+        .bind_source = true,
+        .source = NET_EVENT_SOURCE_STA,
+        .duration_s = CONFIG_BENCH_DURATION_S * 2,
+    };
+    esp_netif_ip_info_t ip_info;
+    if (net_manager_get_ip_info(NET_EVENT_SOURCE_STA, &ip_info) == ESP_OK)
+        ESP_LOGI(TAG, "Peer serving on " IPSTR, IP2STR(&ip_info.ip));
+    for (;;)
+    {
+        net_bench_result_t result;
+        esp_err_t err = net_manager_bench_run(&config, &result);
+        if (err == ESP_OK)
+            ESP_LOGI(TAG, "Served %llu bytes at %lu kbps", (unsigned long long)result.bytes,
+                     (unsigned long)result.throughput_kbps);
+        else if (err != ESP_ERR_TIMEOUT)
+            vTaskDelay(pdMS_TO_TICKS(BENCH_CLIENT_RETRY_MS));
+    }
+}
+#endif // CONFIG_BENCH_ROLE_PEER
+
+void app_main(void)
+{
+    bench_connect();
+#if CONFIG_BENCH_ROLE_PEER
+    peer_serve();
+#else
+    printf("BENCH start traffic_hooks=%d\n", BENCH_TRAFFIC_HOOKS);
+    scenario_throughput();
+    scenario_buffer_profiles();
+    scenario_first_packet();
+    scenario_power_save();
+    printf("BENCH done\n");
+#endif
+}
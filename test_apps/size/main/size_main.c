@@ -0,0 +1,40 @@
+/**
+ * @file size_main.c
+ *
+ * Smallest app that links all of net_manager, so the image size reflects its Kconfig
+ * feature selection. Prints the memory report for the runtime side of the footprint.
+ */
+
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "nvs_flash.h"
+#include "net_manager.h"
+
+static const char *TAG = "NET_SIZE";
+
+void app_main(void)
+{
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        err = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(err);
+    ESP_ERROR_CHECK(net_manager_init(NULL));
+    ESP_ERROR_CHECK(net_manager_start(NULL));
+    vTaskDelay(pdMS_TO_TICKS(2000)); // Let the drivers start
+
+    net_memory_report_t report;
+    ESP_ERROR_CHECK(net_manager_get_memory_report(&report));
+    for (int i = 0; i < NET_MEM_PHASE_MAX; i++)
+    {
+        ESP_LOGI(TAG, "Phase %d: internal %ld bytes (largest block %ld), SPIRAM %ld bytes, %lu runs", i,
+                 (long)report.phases[i].internal_bytes, (long)report.phases[i].internal_largest_block,
+                 (long)report.phases[i].spiram_bytes, (unsigned long)report.phases[i].runs);
+    }
+    ESP_LOGI(TAG, "Static %u bytes, worker stack never used %lu bytes, work queue peak %u",
+             (unsigned)report.static_bytes, (unsigned long)report.worker_stack_free_min, report.work_queue_peak);
+}
@@ -0,0 +1,70 @@
+#!/usr/bin/env python
+"""Builds test_apps/size once per sdkconfig.ci.<name> and prints the flash and RAM use of
+each feature combination, for the whole image and for net_manager alone.
+
+    cd test_apps/size && python size_report.py [--target esp32] [name ...]
+"""
+import argparse
+import glob
+import json
+import os
+import subprocess
+import sys
+
+APP_DIR = os.path.dirname(os.path.abspath(__file__))
+
+
+def idf(build_dir, *args, capture=False):
+    cmd = ['idf.py', '-B', build_dir] + list(args)
+    if capture:
+        return subprocess.run(cmd, cwd=APP_DIR, check=True, stdout=subprocess.PIPE, text=True).stdout
+    subprocess.run(cmd, cwd=APP_DIR, check=True, stdout=subprocess.DEVNULL)
+    return None
+
+
+def json_output(text):
+    # idf.py prints its own lines around the JSON
+    return json.loads(text[text.index('{'):text.rindex('}') + 1])
+
+
+def build_and_measure(name, target):
+    build_dir = os.path.join(APP_DIR, 'build_' + name)
+    defaults = 'sdkconfig.defaults;sdkconfig.ci.' + name
+    idf(build_dir, '-D', 'SDKCONFIG=' + os.path.join(build_dir, 'sdkconfig'), '-D', 'SDKCONFIG_DEFAULTS=' + defaults,
+        '-D', 'IDF_TARGET=' + target, 'build')
+
+    image = json_output(idf(build_dir, 'size', '--format', 'json', capture=True))
+    components = json_output(idf(build_dir, 'size-components', '--format', 'json', capture=True))
+    archive = next((v for k, v in components.items() if 'net_manager' in k and 'bench' not in k), {})
+    return {
+        'flash': image.get('flash_code', 0) + image.get('flash_rodata', 0),
+        'dram': image.get('used_dram', 0),
+        'iram': image.get('used_iram', 0),
+        'nm_flash': archive.get('flash_text', 0) + archive.get('flash_rodata', 0),
+        'nm_ram': archive.get('dram_data', 0) + archive.get('dram_bss', 0),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--target', default='esp32')
+    parser.add_argument('names', nargs='*', help='sdkconfig.ci.<name> combinations, default: all')
+    args = parser.parse_args()
+
+    names = args.names or sorted(os.path.basename(p)[len('sdkconfig.ci.'):]
+                                 for p in glob.glob(os.path.join(APP_DIR, 'sdkconfig.ci.*')))
+    results = {}
+    for name in names:
+        print('Building %s...' % name, file=sys.stderr)
+        results[name] = build_and_measure(name, args.target)
+
+    base = results.get('minimal')
+    print('| Combination | Image flash | DRAM | IRAM | net_manager flash | net_manager RAM | vs minimal (flash/RAM) |')
+    print('|---|---|---|---|---|---|---|')
+    for name, r in results.items():
+        delta = ('%+d / %+d' % (r['nm_flash'] - base['nm_flash'], r['nm_ram'] - base['nm_ram'])) if base else '-'
+        print('| %s | %d | %d | %d | %d | %d | %s |' % (name, r['flash'], r['dram'], r['iram'], r['nm_flash'], r['nm_ram'], delta))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,21 @@
+/**
+ * @file test_app_main.c
+ *
+ * Entry point of the net_manager Unity tests.
+ */
+
+#include "unity.h"
+#include "esp_err.h"
+#include "nvs_flash.h"
+
+void app_main(void)
+{
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        nvs_flash_erase();
+        err = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(err);
+    unity_run_menu();
+}
@@ -0,0 +1,98 @@
+/**
+ * @file test_connected_events.c
+ *
+ * NET_STATUS_CONNECTED is dispatched once per connection, whichever address family comes
+ * first. The STA is started on a network that does not exist, then the tests give its
+ * netif addresses and post the IP events the driver would post.
+ */
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "unity.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "sdkconfig.h"
+#include "net_manager.h"
+#include "test_sta_fixture.h"
+
+#if CONFIG_NET_MANAGER_GW_PREWARM_ENABLED
+#define TEST_EVENT_TIMEOUT_MS (CONFIG_NET_MANAGER_GW_PREWARM_TIMEOUT_MS + 2000)
+#else
+#define TEST_EVENT_TIMEOUT_MS 2000
+#endif
+#define TEST_SETTLE_MS 500 // Time for a duplicate event to show up
+
+/**
+ * @brief Gives the netif a global IPv6 address and posts IP_EVENT_GOT_IP6 for it.
+ */
+static void post_got_ip6(esp_netif_t *netif)
+{
+    ip_event_got_ip6_t event = {.esp_netif = netif};
+    TEST_ESP_OK(esp_netif_str_to_ip6("2001:db8::2", &event.ip6_info.ip));
+    TEST_ESP_OK(esp_netif_add_ip6_address(netif, event.ip6_info.ip, true));
+    TEST_ESP_OK(esp_event_post(IP_EVENT, IP_EVENT_GOT_IP6, &event, sizeof(event), portMAX_DELAY));
+}
+
+/**
+ * @brief Gives the netif an IPv4 address and posts IP_EVENT_STA_GOT_IP for it. The gateway
+ *        never answers ARP, so a CONNECTED event waits the whole prewarm timeout.
+ */
+static void post_got_ip4(esp_netif_t *netif)
+{
+    ip_event_got_ip_t event = {.esp_netif = netif};
+    esp_netif_set_ip4_addr(&event.ip_info.ip, 192, 168, 77, 2);
+    esp_netif_set_ip4_addr(&event.ip_info.netmask, 255, 255, 255, 0);
+    esp_netif_set_ip4_addr(&event.ip_info.gw, 192, 168, 77, 1);
+    TEST_ESP_OK(esp_netif_set_ip_info(netif, &event.ip_info));
+    // esp_netif may post the event as well; a second one is a lease renewal.
+    TEST_ESP_OK(esp_event_post(IP_EVENT, IP_EVENT_STA_GOT_IP, &event, sizeof(event), portMAX_DELAY));
+}
+
+TEST_CASE("IPv4 after IPv6 dispatches ADDRESS_CHANGED, not a second CONNECTED", "[net_manager]")
+{
+    esp_netif_t *netif = test_sta_start_disconnected();
+
+    post_got_ip6(netif);
+    TEST_ASSERT_TRUE(test_wait_sta_event(NET_STATUS_CONNECTED, 1, TEST_EVENT_TIMEOUT_MS));
+    post_got_ip4(netif);
+    TEST_ASSERT_TRUE(test_wait_sta_event(NET_STATUS_ADDRESS_CHANGED, 1, TEST_EVENT_TIMEOUT_MS));
+    vTaskDelay(pdMS_TO_TICKS(TEST_SETTLE_MS));
+
+    TEST_ASSERT_EQUAL(1, test_sta_events(NET_STATUS_CONNECTED));
+    TEST_ASSERT_EQUAL(1, test_sta_events(NET_STATUS_ADDRESS_CHANGED));
+    test_sta_stop();
+}
+
+#if CONFIG_NET_MANAGER_GW_PREWARM_ENABLED
+TEST_CASE("IPv6 during the gateway wait leaves one CONNECTED", "[net_manager]")
+{
+    esp_netif_t *netif = test_sta_start_disconnected();
+
+    post_got_ip4(netif);
+    vTaskDelay(pdMS_TO_TICKS(100));
+    TEST_ASSERT_EQUAL_MESSAGE(0, test_sta_events(NET_STATUS_CONNECTED), "CONNECTED not held for the gateway");
+    post_got_ip6(netif);
+    TEST_ASSERT_TRUE(test_wait_sta_event(NET_STATUS_CONNECTED, 1, TEST_EVENT_TIMEOUT_MS));
+    // The held event completes as ADDRESS_CHANGED when the prewarm times out.
+    TEST_ASSERT_TRUE(test_wait_sta_event(NET_STATUS_ADDRESS_CHANGED, 1, TEST_EVENT_TIMEOUT_MS));
+    vTaskDelay(pdMS_TO_TICKS(TEST_SETTLE_MS));
+
+    TEST_ASSERT_EQUAL(1, test_sta_events(NET_STATUS_CONNECTED));
+    test_sta_stop();
+}
+#endif
+
+TEST_CASE("DHCP renewal with the same address dispatches nothing", "[net_manager]")
+{
+    esp_netif_t *netif = test_sta_start_disconnected();
+
+    post_got_ip4(netif);
+    TEST_ASSERT_TRUE(test_wait_sta_event(NET_STATUS_CONNECTED, 1, TEST_EVENT_TIMEOUT_MS));
+    post_got_ip4(netif);
+    vTaskDelay(pdMS_TO_TICKS(TEST_SETTLE_MS));
+
+    TEST_ASSERT_EQUAL(1, test_sta_events(NET_STATUS_CONNECTED));
+    TEST_ASSERT_EQUAL(0, test_sta_events(NET_STATUS_ADDRESS_CHANGED));
+    test_sta_stop();
+}
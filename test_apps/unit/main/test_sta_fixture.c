@@ -0,0 +1,57 @@
+/**
+ * @file test_sta_fixture.c
+ *
+ * See test_sta_fixture.h.
+ */
+
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "unity.h"
+#include "test_sta_fixture.h"
+
+#define TEST_DISCONNECT_TIMEOUT_MS 30000 // Scan for the missing network
+
+static atomic_int s_sta_events[NET_STATUS_CONFIG_ROLLBACK + 1];
+
+static void test_event_cb(const net_manager_event_t *event)
+{
+    if (event->source == NET_EVENT_SOURCE_STA && event->status <= NET_STATUS_CONFIG_ROLLBACK)
+        atomic_fetch_add(&s_sta_events[event->status], 1);
+}
+
+int test_sta_events(net_status_t status)
+{
+    return atomic_load(&s_sta_events[status]);
+}
+
+bool test_wait_sta_event(net_status_t status, int count, uint32_t timeout_ms)
+{
+    for (uint32_t waited = 0; test_sta_events(status) < count; waited += 10)
+    {
+        if (waited >= timeout_ms)
+            return false;
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return true;
+}
+
+esp_netif_t *test_sta_start_disconnected(void)
+{
+    for (int i = 0; i <= NET_STATUS_CONFIG_ROLLBACK; i++)
+        atomic_store(&s_sta_events[i], 0);
+    TEST_ESP_OK(net_manager_init(test_event_cb));
+    TEST_ESP_OK(net_manager_start(NULL));
+    TEST_ASSERT_TRUE_MESSAGE(test_wait_sta_event(NET_STATUS_DISCONNECTED, 1, TEST_DISCONNECT_TIMEOUT_MS),
+                             "STA did not give up on the missing network");
+    esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    TEST_ASSERT_NOT_NULL(netif);
+    esp_netif_dhcpc_stop(netif); // The tests set the addresses
+    return netif;
+}
+
+void test_sta_stop(void)
+{
+    TEST_ESP_OK(net_manager_stop());
+    TEST_ESP_OK(net_manager_deinit());
+}
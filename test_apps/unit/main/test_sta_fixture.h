@@ -0,0 +1,37 @@
+/**
+ * @file test_sta_fixture.h
+ *
+ * Shared setup of the net_manager Unity tests: an STA started on a network that does
+ * not exist, whose netif the tests drive by posting the IP events of the driver.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_netif.h"
+#include "net_manager.h"
+
+/**
+ * @brief Starts net_manager with the STA only and waits until the STA gave up on the
+ *        missing network, so no driver event races the ones posted by the test. Clears
+ *        the event counts and stops the DHCP client of the netif.
+ * @return The STA netif.
+ */
+esp_netif_t *test_sta_start_disconnected(void);
+
+/**
+ * @brief Stops and deinitializes net_manager.
+ */
+void test_sta_stop(void);
+
+/**
+ * @brief Number of STA events of a status dispatched since test_sta_start_disconnected().
+ */
+int test_sta_events(net_status_t status);
+
+/**
+ * @brief Waits until count STA events of a status were dispatched.
+ * @return false on timeout.
+ */
+bool test_wait_sta_event(net_status_t status, int count, uint32_t timeout_ms);
@@ -0,0 +1,8 @@
+import pytest
+from pytest_embedded import Dut
+
+
+@pytest.mark.generic
+@pytest.mark.parametrize('config', ['default', 'static_alloc'], indirect=True)
+def test_net_manager_unit(dut: Dut) -> None:
+    dut.run_all_single_board_cases(group='net_manager', timeout=120)